@@ -401,6 +401,26 @@ WREN_API void wrenEnsureSlots(WrenVM* vm, int numSlots);
 // Gets the type of the object in [slot].
 WREN_API WrenType wrenGetSlotType(WrenVM* vm, int slot);
 
+// Gets the name of the class of the object in [slot], the string belongs to
+// the class and stays valid for as long as the class does.
+WREN_API const char* wrenGetSlotClassName(WrenVM* vm, int slot);
+
+// Stores the class of the object in [slot] into [classSlot].
+WREN_API void wrenGetSlotClass(WrenVM* vm, int slot, int classSlot);
+
+// Gets a pointer that tells the class of the object in [slot] apart from every
+// other living class. It is only good for comparing, never dereference it.
+WREN_API const void* wrenGetSlotClassIdentity(WrenVM* vm, int slot);
+
+// Gets a pointer that tells the object in [slot] apart from every other living
+// object, or NULL if it is not an object. It is only good for comparing, never
+// dereference it.
+WREN_API const void* wrenGetSlotIdentity(WrenVM* vm, int slot);
+
+// Returns true if the class of the object in [slot] has a method with
+// [signature], looking through what it inherited as well.
+WREN_API bool wrenHasMethod(WrenVM* vm, int slot, const char* signature);
+
 // Reads a boolean value from [slot].
 //
 // It is an error to call this if the slot does not contain a boolean value.
@@ -430,6 +450,13 @@ WREN_API double wrenGetSlotDouble(WrenVM* vm, int slot);
 // foreign class.
 WREN_API void* wrenGetSlotForeign(WrenVM* vm, int slot);
 
+// Reads a range from [slot] into [from], [to] and [isInclusive].
+//
+// Returns false and leaves the outputs untouched if the slot does not contain
+// a range. Ranges have no slot type of their own, so this doubles as the test.
+WREN_API bool wrenGetSlotRange(WrenVM* vm, int slot, double* from, double* to,
+                               bool* isInclusive);
+
 // Reads a string from [slot].
 //
 // The memory for the returned string is owned by Wren. You can inspect it
@@ -508,9 +535,41 @@ WREN_API void wrenSetListElement(WrenVM* vm, int listSlot, int index, int elemen
 // an element, use `-1` for the index.
 WREN_API void wrenInsertInList(WrenVM* vm, int listSlot, int index, int elementSlot);
 
+// Makes room for at least [capacity] elements in the list stored in [slot]
+// without changing its count, so later appends do not need to grow it.
+WREN_API void wrenReserveList(WrenVM* vm, int slot, int capacity);
+
+// Reads [count] elements starting at [index] from the list in [listSlot] into
+// the slots starting at [firstSlot].
+WREN_API void wrenGetListElements(WrenVM* vm, int listSlot, int index, int count,
+                                  int firstSlot);
+
+// Writes the values in the [count] slots starting at [firstSlot] into the list
+// in [listSlot], starting at [index].
+//
+// [index] may be the count of the list, and the range may run past its end, in
+// which case the list grows to fit. Use [wrenReserveList()] first to grow it in
+// one step when appending a lot of elements.
+WREN_API void wrenSetListElements(WrenVM* vm, int listSlot, int index, int count,
+                                  int firstSlot);
+
 // Returns the number of entries in the map stored in [slot].
 WREN_API int wrenGetMapCount(WrenVM* vm, int slot);
 
+// Returns the number of internal entry positions of the map stored in [slot],
+// some of which may be empty. Together with [wrenGetMapEntry()] this walks a
+// map without calling into Wren.
+WREN_API int wrenGetMapCapacity(WrenVM* vm, int slot);
+
+// If the internal position [index] of the map in [mapSlot] holds an entry,
+// stores its key in [keySlot] and its value in [valueSlot] and returns true.
+// Returns false and leaves the slots alone if the position is empty.
+//
+// [index] must be between 0 and the map's capacity. Entries are visited in the
+// same (unspecified) order as iterating the map from Wren.
+WREN_API bool wrenGetMapEntry(WrenVM* vm, int mapSlot, int index, int keySlot,
+                              int valueSlot);
+
 // Returns true if the key in [keySlot] is found in the map placed in [mapSlot].
 WREN_API bool wrenGetMapContainsKey(WrenVM* vm, int mapSlot, int keySlot);
 
@@ -541,6 +600,35 @@ WREN_API bool wrenHasVariable(WrenVM* vm, const char* module, const char* name);
 // Returns true if [module] has been imported/resolved before, false if not.
 WREN_API bool wrenHasModule(WrenVM* vm, const char* module);
 
+// Sets the top level variable [name] in [module] to [value], defining it if
+// it doesn't exist yet. A module that hasn't been imported is created, so the
+// variable is there when its source is compiled into it later. A NULL [module]
+// is the core module, whose variables every module imports implicitly, the
+// ones that already exist included unless they have their own variable of
+// that name. Returns false if the variable could not be defined.
+WREN_API bool wrenSetModuleVariable(WrenVM* vm, const char* module,
+                                    const char* name, WrenHandle* value);
+
+// Returns a handle to resolved [module], or NULL if it hasn't been imported.
+// Together with wrenGetVariableIndex it finds a top level variable once, so
+// wrenGetVariableAt and wrenSetVariableAt reach it without any lookup.
+WREN_API WrenHandle* wrenGetModuleHandle(WrenVM* vm, const char* module);
+
+// Returns the index of the top level variable [name] in the module held by
+// [module], or -1 if there is no such variable.
+WREN_API int wrenGetVariableIndex(WrenVM* vm, WrenHandle* module,
+                                 const char* name);
+
+// Stores the top level variable at [index] of the module held by [module] in
+// [slot].
+WREN_API void wrenGetVariableAt(WrenVM* vm, WrenHandle* module, int index,
+                                int slot);
+
+// Sets the top level variable at [index] of the module held by [module] to the
+// value in [slot].
+WREN_API void wrenSetVariableAt(WrenVM* vm, WrenHandle* module, int index,
+                                int slot);
+
 // Sets the current fiber to be aborted, and uses the value in [slot] as the
 // runtime error object.
 WREN_API void wrenAbortFiber(WrenVM* vm, int slot);
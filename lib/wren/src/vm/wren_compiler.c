@@ -2580,9 +2580,30 @@ static void conditional(Compiler* compiler, bool canAssign)
   patchJump(compiler, elseJump);
 }
 
+// Returns the instruction with a fast path for two numbers for the infix
+// operator [type], or CODE_END if it's always a plain call.
+static Code numberOperator(TokenType type)
+{
+  switch (type)
+  {
+    case TOKEN_PLUS:   return CODE_ADD;
+    case TOKEN_MINUS:  return CODE_SUB;
+    case TOKEN_STAR:   return CODE_MUL;
+    case TOKEN_SLASH:  return CODE_DIV;
+    case TOKEN_LT:     return CODE_LT;
+    case TOKEN_LTEQ:   return CODE_LTE;
+    case TOKEN_GT:     return CODE_GT;
+    case TOKEN_GTEQ:   return CODE_GTE;
+    case TOKEN_EQEQ:   return CODE_EQ;
+    case TOKEN_BANGEQ: return CODE_NEQ;
+    default:           return CODE_END;
+  }
+}
+
 void infixOp(Compiler* compiler, bool canAssign)
 {
   GrammarRule* rule = getRule(compiler->parser->previous.type);
+  Code instruction = numberOperator(compiler->parser->previous.type);
 
   // An infix operator cannot end an expression.
   ignoreNewlines(compiler);
@@ -2592,7 +2613,14 @@ void infixOp(Compiler* compiler, bool canAssign)
 
   // Call the operator method on the left-hand side.
   Signature signature = { rule->name, (int)strlen(rule->name), SIG_METHOD, 1 };
-  callSignature(compiler, CODE_CALL_0, &signature);
+  if (instruction != CODE_END)
+  {
+    emitShortArg(compiler, instruction, signatureSymbol(compiler, &signature));
+  }
+  else
+  {
+    callSignature(compiler, CODE_CALL_0, &signature);
+  }
 }
 
 // Compiles a method signature for an infix operator.
@@ -2919,6 +2947,16 @@ static int getByteCountForArguments(const uint8_t* bytecode,
     case CODE_CALL_14:
     case CODE_CALL_15:
     case CODE_CALL_16:
+    case CODE_ADD:
+    case CODE_SUB:
+    case CODE_MUL:
+    case CODE_DIV:
+    case CODE_LT:
+    case CODE_LTE:
+    case CODE_GT:
+    case CODE_GTE:
+    case CODE_EQ:
+    case CODE_NEQ:
     case CODE_JUMP:
     case CODE_LOOP:
     case CODE_JUMP_IF:
@@ -2930,6 +2968,10 @@ static int getByteCountForArguments(const uint8_t* bytecode,
     case CODE_IMPORT_VARIABLE:
       return 2;
 
+    case CODE_ITERATE:
+    case CODE_ITERATOR_VALUE:
+      return 3;
+
     case CODE_SUPER_0:
     case CODE_SUPER_1:
     case CODE_SUPER_2:
@@ -3051,6 +3093,8 @@ static void forStatement(Compiler* compiler)
   //   it should exit the loop.
   // - The .iteratorValue() method is used to get the value at the current
   //   iterator position.
+  // - When the sequence is a Range, both are done inline by the ITERATE and
+  //   ITERATOR_VALUE instructions without calling anything.
 
   // Create a scope for the hidden local variables used for the iterator.
   pushScope(compiler);
@@ -3090,19 +3134,25 @@ static void forStatement(Compiler* compiler)
   Loop loop;
   startLoop(compiler, &loop);
 
-  // Advance the iterator by calling the ".iterate" method on the sequence.
-  loadLocal(compiler, seqSlot);
-  loadLocal(compiler, iterSlot);
+  // Advance the iterator by calling the ".iterate" method on the sequence. The
+  // instruction steps a Range itself and only makes the call for other
+  // sequences, which needs room for the sequence and iterator as arguments.
+  if (compiler->numSlots + 2 > compiler->fn->maxSlots)
+  {
+    compiler->fn->maxSlots = compiler->numSlots + 2;
+  }
+
+  emitByteArg(compiler, CODE_ITERATE, seqSlot);
+  emitShort(compiler, methodSymbol(compiler, "iterate(_)", 10));
 
   // Update and test the iterator.
-  callMethod(compiler, 1, "iterate(_)", 10);
   emitByteArg(compiler, CODE_STORE_LOCAL, iterSlot);
   testExitLoop(compiler);
 
-  // Get the current value in the sequence by calling ".iteratorValue".
-  loadLocal(compiler, seqSlot);
-  loadLocal(compiler, iterSlot);
-  callMethod(compiler, 1, "iteratorValue(_)", 16);
+  // Get the current value in the sequence by calling ".iteratorValue". The
+  // slots needed for a call were already counted above.
+  emitByteArg(compiler, CODE_ITERATOR_VALUE, seqSlot);
+  emitShort(compiler, methodSymbol(compiler, "iteratorValue(_)", 16));
 
   // Bind the loop variable in its own scope. This ensures we get a fresh
   // variable each iteration so that closures for it don't all see the same one.
@@ -3783,18 +3833,26 @@ ObjFn* wrenCompile(WrenVM* vm, ObjModule* module, const char* source,
   parser.next.line = 0;
   parser.next.value = UNDEFINED_VAL;
 
+  // The GC marks all three tokens, so none can be left as uninitialized stack
+  // memory.
+  parser.current = parser.next;
+  parser.previous = parser.next;
+
   parser.printErrors = printErrors;
   parser.hasError = false;
 
+  int numExistingVariables = module->variables.count;
+
+  // Set up the compiler before lexing, it is what makes the GC see the string
+  // values the lexer hangs on the tokens.
+  Compiler compiler;
+  initCompiler(&compiler, &parser, NULL, false);
+
   // Read the first token into next
   nextToken(&parser);
   // Copy next -> current
   nextToken(&parser);
 
-  int numExistingVariables = module->variables.count;
-
-  Compiler compiler;
-  initCompiler(&compiler, &parser, NULL, false);
   ignoreNewlines(&compiler);
 
   if (isExpression)
@@ -125,6 +125,14 @@ static int dumpInstruction(WrenVM* vm, ObjFn* fn, int i, int* lastLine)
       printf("%-16s %5d\n", name, READ_BYTE());                                \
       break
 
+  #define OPERATOR_INSTRUCTION(name)                                           \
+      {                                                                        \
+        int symbol = READ_SHORT();                                             \
+        printf("%-16s %5d '%s'\n", name, symbol,                               \
+               vm->methodNames.data[symbol]->value);                           \
+        break;                                                                 \
+      }
+
   switch (code)
   {
     case CODE_CONSTANT:
@@ -203,6 +211,28 @@ static int dumpInstruction(WrenVM* vm, ObjFn* fn, int i, int* lastLine)
       break;
     }
 
+    case CODE_ADD: OPERATOR_INSTRUCTION("ADD");
+    case CODE_SUB: OPERATOR_INSTRUCTION("SUB");
+    case CODE_MUL: OPERATOR_INSTRUCTION("MUL");
+    case CODE_DIV: OPERATOR_INSTRUCTION("DIV");
+    case CODE_LT: OPERATOR_INSTRUCTION("LT");
+    case CODE_LTE: OPERATOR_INSTRUCTION("LTE");
+    case CODE_GT: OPERATOR_INSTRUCTION("GT");
+    case CODE_GTE: OPERATOR_INSTRUCTION("GTE");
+    case CODE_EQ: OPERATOR_INSTRUCTION("EQ");
+    case CODE_NEQ: OPERATOR_INSTRUCTION("NEQ");
+
+    case CODE_ITERATE:
+    case CODE_ITERATOR_VALUE:
+    {
+      int slot = READ_BYTE();
+      int symbol = READ_SHORT();
+      printf("%-16s %5d %5d '%s'\n",
+             code == CODE_ITERATE ? "ITERATE" : "ITERATOR_VALUE", slot, symbol,
+             vm->methodNames.data[symbol]->value);
+      break;
+    }
+
     case CODE_SUPER_0:
     case CODE_SUPER_1:
     case CODE_SUPER_2:
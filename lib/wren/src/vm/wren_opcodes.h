@@ -117,6 +117,30 @@ OPCODE(SUPER_14, -14)
 OPCODE(SUPER_15, -15)
 OPCODE(SUPER_16, -16)
 
+// A binary operator, done in place when both operands are numbers and
+// otherwise a call to method symbol [arg] on the left operand, like CALL_1.
+OPCODE(ADD, -1)
+OPCODE(SUB, -1)
+OPCODE(MUL, -1)
+OPCODE(DIV, -1)
+OPCODE(LT, -1)
+OPCODE(LTE, -1)
+OPCODE(GT, -1)
+OPCODE(GTE, -1)
+OPCODE(EQ, -1)
+OPCODE(NEQ, -1)
+
+// Advance a for loop's iterator. The sequence is in local slot [arg1] and the
+// iterator in the slot after it. A Range is stepped in place, any other
+// sequence gets method symbol [arg2] ("iterate(_)") called on it. Pushes the
+// new iterator.
+OPCODE(ITERATE, 1)
+
+// Push the value at a for loop's iterator, with the same arguments as
+// ITERATE. For a Range that's the iterator itself, otherwise it's the result
+// of calling method symbol [arg2] ("iteratorValue(_)").
+OPCODE(ITERATOR_VALUE, 1)
+
 // Jump the instruction pointer [arg] forward.
 OPCODE(JUMP, 0)
 
@@ -7,14 +7,72 @@ DEFINE_BUFFER(Byte, uint8_t);
 DEFINE_BUFFER(Int, int);
 DEFINE_BUFFER(String, ObjString*);
 
+// The index starts at this many entries, once there is a symbol to hold.
+#define SYMBOL_INDEX_MIN 16
+
+// Must match the hash wren_value.c stores in every ObjString, so a symbol
+// added from its string can be found again from a bare name.
+static uint32_t hashName(const char* name, size_t length)
+{
+  // FNV-1a hash. See: http://www.isthe.com/chongo/tech/comp/fnv/
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    hash ^= name[i];
+    hash *= 16777619;
+  }
+
+  return hash;
+}
+
+// Adds [symbol] to the index, unless an earlier symbol has the same name so
+// the first one added is always the one found.
+static void indexSymbol(SymbolTable* symbols, int symbol)
+{
+  ObjString* name = symbols->data[symbol];
+  uint32_t mask = (uint32_t)symbols->indexCapacity - 1;
+  uint32_t entry = name->hash & mask;
+
+  while (symbols->index[entry] != 0)
+  {
+    ObjString* existing = symbols->data[symbols->index[entry] - 1];
+    if (existing->hash == name->hash &&
+        wrenStringEqualsCString(existing, name->value, name->length))
+    {
+      return;
+    }
+
+    entry = (entry + 1) & mask;
+  }
+
+  symbols->index[entry] = symbol + 1;
+}
+
+static void resizeIndex(WrenVM* vm, SymbolTable* symbols, int capacity)
+{
+  wrenReallocate(vm, symbols->index, 0, 0);
+  symbols->index = (int*)wrenReallocate(vm, NULL, 0, capacity * sizeof(int));
+  symbols->indexCapacity = capacity;
+  memset(symbols->index, 0, capacity * sizeof(int));
+
+  for (int i = 0; i < symbols->count; i++) indexSymbol(symbols, i);
+}
+
 void wrenSymbolTableInit(SymbolTable* symbols)
 {
-  wrenStringBufferInit(symbols);
+  symbols->data = NULL;
+  symbols->count = 0;
+  symbols->capacity = 0;
+  symbols->index = NULL;
+  symbols->indexCapacity = 0;
 }
 
 void wrenSymbolTableClear(WrenVM* vm, SymbolTable* symbols)
 {
-  wrenStringBufferClear(vm, symbols);
+  wrenReallocate(vm, symbols->data, 0, 0);
+  wrenReallocate(vm, symbols->index, 0, 0);
+  wrenSymbolTableInit(symbols);
 }
 
 int wrenSymbolTableAdd(WrenVM* vm, SymbolTable* symbols,
@@ -23,7 +81,28 @@ int wrenSymbolTableAdd(WrenVM* vm, SymbolTable* symbols,
   ObjString* symbol = AS_STRING(wrenNewStringLength(vm, name, length));
   
   wrenPushRoot(vm, &symbol->obj);
-  wrenStringBufferWrite(vm, symbols, symbol);
+
+  if (symbols->capacity < symbols->count + 1)
+  {
+    int capacity = wrenPowerOf2Ceil(symbols->count + 1);
+    symbols->data = (ObjString**)wrenReallocate(vm, symbols->data,
+        symbols->capacity * sizeof(ObjString*), capacity * sizeof(ObjString*));
+    symbols->capacity = capacity;
+  }
+
+  symbols->data[symbols->count++] = symbol;
+
+  if (symbols->count * 2 > symbols->indexCapacity)
+  {
+    int capacity = symbols->indexCapacity * 2;
+    if (capacity < SYMBOL_INDEX_MIN) capacity = SYMBOL_INDEX_MIN;
+    resizeIndex(vm, symbols, capacity);
+  }
+  else
+  {
+    indexSymbol(symbols, symbols->count - 1);
+  }
+
   wrenPopRoot(vm);
   
   return symbols->count - 1;
@@ -43,11 +122,21 @@ int wrenSymbolTableEnsure(WrenVM* vm, SymbolTable* symbols,
 int wrenSymbolTableFind(const SymbolTable* symbols,
                         const char* name, size_t length)
 {
-  // See if the symbol is already defined.
-  // TODO: O(n). Do something better.
-  for (int i = 0; i < symbols->count; i++)
+  if (symbols->count == 0) return -1;
+
+  uint32_t hash = hashName(name, length);
+  uint32_t mask = (uint32_t)symbols->indexCapacity - 1;
+
+  // The index is never full, so there is always an empty entry to stop at.
+  for (uint32_t entry = hash & mask; symbols->index[entry] != 0;
+       entry = (entry + 1) & mask)
   {
-    if (wrenStringEqualsCString(symbols->data[i], name, length)) return i;
+    ObjString* symbol = symbols->data[symbols->index[entry] - 1];
+    if (symbol->hash == hash &&
+        wrenStringEqualsCString(symbol, name, length))
+    {
+      return symbols->index[entry] - 1;
+    }
   }
 
   return -1;
@@ -62,6 +151,7 @@ void wrenBlackenSymbolTable(WrenVM* vm, SymbolTable* symbolTable)
   
   // Keep track of how much memory is still in use.
   vm->bytesAllocated += symbolTable->capacity * sizeof(*symbolTable->data);
+  vm->bytesAllocated += symbolTable->indexCapacity * sizeof(int);
 }
 
 int wrenUtf8EncodeNumBytes(int value)
@@ -67,8 +67,20 @@ DECLARE_BUFFER(Byte, uint8_t);
 DECLARE_BUFFER(Int, int);
 DECLARE_BUFFER(String, ObjString*);
 
-// TODO: Change this to use a map.
-typedef StringBuffer SymbolTable;
+// The symbols in order, with an open addressing hash index alongside so a
+// lookup doesn't have to compare against every name. [data] and [count] are
+// laid out like a StringBuffer's and may be read directly.
+typedef struct
+{
+  ObjString** data;
+  int count;
+  int capacity;
+
+  // Each entry is a symbol plus one, zero is an empty entry. The capacity is
+  // a power of two kept at least twice the number of symbols.
+  int* index;
+  int indexCapacity;
+} SymbolTable;
 
 // Initializes the symbol table.
 void wrenSymbolTableInit(SymbolTable* symbols);
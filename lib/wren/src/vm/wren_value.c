@@ -32,7 +32,6 @@
 #define INITIAL_CALL_FRAMES 4
 
 DEFINE_BUFFER(Value, Value);
-DEFINE_BUFFER(Method, Method);
 
 static void initObj(WrenVM* vm, Obj* obj, ObjType type, ObjClass* classObj)
 {
@@ -52,13 +51,27 @@ ObjClass* wrenNewSingleClass(WrenVM* vm, int numFields, ObjString* name)
   classObj->name = name;
   classObj->attributes = NULL_VAL;
 
-  wrenPushRoot(vm, (Obj*)classObj);
-  wrenMethodBufferInit(&classObj->methods);
-  wrenPopRoot(vm);
+  classObj->methods.pages = NULL;
+  classObj->methods.count = 0;
 
   return classObj;
 }
 
+// Makes sure [classObj] has room for at least [count] method pages.
+static void ensureMethodPages(WrenVM* vm, ObjClass* classObj, int count)
+{
+  if (count <= classObj->methods.count) return;
+
+  classObj->methods.pages = (MethodPage**)wrenReallocate(vm,
+      classObj->methods.pages, classObj->methods.count * sizeof(MethodPage*),
+      count * sizeof(MethodPage*));
+  for (int i = classObj->methods.count; i < count; i++)
+  {
+    classObj->methods.pages[i] = NULL;
+  }
+  classObj->methods.count = count;
+}
+
 void wrenBindSuperclass(WrenVM* vm, ObjClass* subclass, ObjClass* superclass)
 {
   ASSERT(superclass != NULL, "Must have superclass.");
@@ -76,10 +89,27 @@ void wrenBindSuperclass(WrenVM* vm, ObjClass* subclass, ObjClass* superclass)
            "A foreign class cannot inherit from a class with fields.");
   }
 
-  // Inherit methods from its superclass.
+  // Inherit methods from its superclass, sharing its pages where the subclass
+  // has none of its own yet.
+  ensureMethodPages(vm, subclass, superclass->methods.count);
   for (int i = 0; i < superclass->methods.count; i++)
   {
-    wrenBindMethod(vm, subclass, i, superclass->methods.data[i]);
+    MethodPage* page = superclass->methods.pages[i];
+    if (page == NULL) continue;
+
+    if (subclass->methods.pages[i] == NULL)
+    {
+      page->refs++;
+      subclass->methods.pages[i] = page;
+      continue;
+    }
+
+    for (int j = 0; j < METHOD_PAGE_SIZE; j++)
+    {
+      if (page->methods[j].type == METHOD_NONE) continue;
+      wrenBindMethod(vm, subclass, (i << METHOD_PAGE_BITS) + j,
+                     page->methods[j]);
+    }
   }
 }
 
@@ -119,16 +149,33 @@ ObjClass* wrenNewClass(WrenVM* vm, ObjClass* superclass, int numFields,
 
 void wrenBindMethod(WrenVM* vm, ObjClass* classObj, int symbol, Method method)
 {
-  // Make sure the buffer is big enough to contain the symbol's index.
-  if (symbol >= classObj->methods.count)
+  int index = symbol >> METHOD_PAGE_BITS;
+  ensureMethodPages(vm, classObj, index + 1);
+
+  // A page of its own, either new or copied from the one it shares.
+  MethodPage* page = classObj->methods.pages[index];
+  if (page == NULL || page->refs > 1)
   {
-    Method noMethod;
-    noMethod.type = METHOD_NONE;
-    wrenMethodBufferFill(vm, &classObj->methods, noMethod,
-                         symbol - classObj->methods.count + 1);
+    MethodPage* owned = ALLOCATE(vm, MethodPage);
+    owned->refs = 1;
+    if (page == NULL)
+    {
+      for (int i = 0; i < METHOD_PAGE_SIZE; i++)
+      {
+        owned->methods[i].type = METHOD_NONE;
+      }
+    }
+    else
+    {
+      memcpy(owned->methods, page->methods, sizeof(owned->methods));
+      page->refs--;
+    }
+
+    classObj->methods.pages[index] = owned;
+    page = owned;
   }
 
-  classObj->methods.data[symbol] = method;
+  page->methods[symbol & (METHOD_PAGE_SIZE - 1)] = method;
 }
 
 ObjClosure* wrenNewClosure(WrenVM* vm, ObjFn* fn)
@@ -1018,13 +1065,22 @@ static void blackenClass(WrenVM* vm, ObjClass* classObj)
   // The superclass.
   wrenGrayObj(vm, (Obj*)classObj->superclass);
 
-  // Method function objects.
+  // Method function objects, a shared page is only counted once between the
+  // classes pointing at it.
   for (int i = 0; i < classObj->methods.count; i++)
   {
-    if (classObj->methods.data[i].type == METHOD_BLOCK)
+    MethodPage* page = classObj->methods.pages[i];
+    if (page == NULL) continue;
+
+    for (int j = 0; j < METHOD_PAGE_SIZE; j++)
     {
-      wrenGrayObj(vm, (Obj*)classObj->methods.data[i].as.closure);
+      if (page->methods[j].type == METHOD_BLOCK)
+      {
+        wrenGrayObj(vm, (Obj*)page->methods[j].as.closure);
+      }
     }
+
+    vm->bytesAllocated += sizeof(MethodPage) / page->refs;
   }
 
   wrenGrayObj(vm, (Obj*)classObj->name);
@@ -1033,7 +1089,7 @@ static void blackenClass(WrenVM* vm, ObjClass* classObj)
 
   // Keep track of how much memory is still in use.
   vm->bytesAllocated += sizeof(ObjClass);
-  vm->bytesAllocated += classObj->methods.capacity * sizeof(Method);
+  vm->bytesAllocated += classObj->methods.count * sizeof(MethodPage*);
 }
 
 static void blackenClosure(WrenVM* vm, ObjClosure* closure)
@@ -1234,8 +1290,16 @@ void wrenFreeObj(WrenVM* vm, Obj* obj)
   switch (obj->type)
   {
     case OBJ_CLASS:
-      wrenMethodBufferClear(vm, &((ObjClass*)obj)->methods);
+    {
+      MethodTable* methods = &((ObjClass*)obj)->methods;
+      for (int i = 0; i < methods->count; i++)
+      {
+        MethodPage* page = methods->pages[i];
+        if (page != NULL && --page->refs == 0) DEALLOCATE(vm, page);
+      }
+      DEALLOCATE(vm, methods->pages);
       break;
+    }
 
     case OBJ_FIBER:
     {
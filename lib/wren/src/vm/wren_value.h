@@ -387,7 +387,27 @@ typedef struct
   } as;
 } Method;
 
-DECLARE_BUFFER(Method, Method);
+// A class's methods are kept in pages of this many, by symbol.
+#define METHOD_PAGE_BITS 5
+#define METHOD_PAGE_SIZE (1 << METHOD_PAGE_BITS)
+
+typedef struct
+{
+  // The number of classes whose table points at this page. A subclass starts
+  // out pointing at its superclass's pages, and a page is copied before it is
+  // written when more than one class points at it.
+  int refs;
+
+  Method methods[METHOD_PAGE_SIZE];
+} MethodPage;
+
+typedef struct
+{
+  // Indexed by symbol >> METHOD_PAGE_BITS, NULL where the class has no
+  // methods in that page.
+  MethodPage** pages;
+  int count;
+} MethodTable;
 
 struct sObjClass
 {
@@ -399,14 +419,12 @@ struct sObjClass
   int numFields;
 
   // The table of methods that are defined in or inherited by this class.
-  // Methods are called by symbol, and the symbol directly maps to an index in
-  // this table. This makes method calls fast at the expense of empty cells in
-  // the list for methods the class doesn't support.
-  //
-  // You can think of it as a hash table that never has collisions but has a
-  // really low load factor. Since methods are pretty small (just a type and a
-  // pointer), this should be a worthwhile trade-off.
-  MethodBuffer methods;
+  // Methods are called by symbol, and the symbol maps to a page and an index
+  // in it, so a call is still two loads with no searching. Only pages that
+  // hold a method exist, and inherited pages are shared with the superclass
+  // until one of them changes, so a class costs little more than the methods
+  // it defines itself. Use wrenGetClassMethod() to look one up.
+  MethodTable methods;
 
   // The name of the class.
   ObjString* name;
@@ -633,6 +651,19 @@ ObjClass* wrenNewClass(WrenVM* vm, ObjClass* superclass, int numFields,
 
 void wrenBindMethod(WrenVM* vm, ObjClass* classObj, int symbol, Method method);
 
+// Returns the method [classObj] has for [symbol], or NULL if it has none.
+static inline Method* wrenGetClassMethod(ObjClass* classObj, int symbol)
+{
+  int page = symbol >> METHOD_PAGE_BITS;
+  if (page >= classObj->methods.count) return NULL;
+
+  MethodPage* methods = classObj->methods.pages[page];
+  if (methods == NULL) return NULL;
+
+  Method* method = &methods->methods[symbol & (METHOD_PAGE_SIZE - 1)];
+  return method->type == METHOD_NONE ? NULL : method;
+}
+
 // Creates a new closure object that invokes [fn]. Allocates room for its
 // upvalues, but assumes outside code will populate it.
 ObjClosure* wrenNewClosure(WrenVM* vm, ObjFn* fn);
@@ -450,37 +450,43 @@ static ObjModule* getModule(WrenVM* vm, Value name)
   return !IS_UNDEFINED(moduleValue) ? AS_MODULE(moduleValue) : NULL;
 }
 
-static ObjClosure* compileInModule(WrenVM* vm, Value name, const char* source,
-                                   bool isExpression, bool printErrors)
+// Creates the module [name], registers it and implicitly imports the core
+// module into it.
+static ObjModule* newModule(WrenVM* vm, Value name)
 {
-  // See if the module has already been loaded.
-  ObjModule* module = getModule(vm, name);
-  if (module == NULL)
-  {
-    module = wrenNewModule(vm, AS_STRING(name));
+  ObjModule* module = wrenNewModule(vm, AS_STRING(name));
 
-    // It's possible for the wrenMapSet below to resize the modules map,
-    // and trigger a GC while doing so. When this happens it will collect
-    // the module we've just created. Once in the map it is safe.
-    wrenPushRoot(vm, (Obj*)module);
+  // It's possible for the wrenMapSet below to resize the modules map,
+  // and trigger a GC while doing so. When this happens it will collect
+  // the module we've just created. Once in the map it is safe.
+  wrenPushRoot(vm, (Obj*)module);
 
-    // Store it in the VM's module registry so we don't load the same module
-    // multiple times.
-    wrenMapSet(vm, vm->modules, name, OBJ_VAL(module));
+  // Store it in the VM's module registry so we don't load the same module
+  // multiple times.
+  wrenMapSet(vm, vm->modules, name, OBJ_VAL(module));
 
-    wrenPopRoot(vm);
+  wrenPopRoot(vm);
 
-    // Implicitly import the core module.
-    ObjModule* coreModule = getModule(vm, NULL_VAL);
-    for (int i = 0; i < coreModule->variables.count; i++)
-    {
-      wrenDefineVariable(vm, module,
-                         coreModule->variableNames.data[i]->value,
-                         coreModule->variableNames.data[i]->length,
-                         coreModule->variables.data[i], NULL);
-    }
+  // Implicitly import the core module.
+  ObjModule* coreModule = getModule(vm, NULL_VAL);
+  for (int i = 0; i < coreModule->variables.count; i++)
+  {
+    wrenDefineVariable(vm, module,
+                       coreModule->variableNames.data[i]->value,
+                       coreModule->variableNames.data[i]->length,
+                       coreModule->variables.data[i], NULL);
   }
 
+  return module;
+}
+
+static ObjClosure* compileInModule(WrenVM* vm, Value name, const char* source,
+                                   bool isExpression, bool printErrors)
+{
+  // See if the module has already been loaded.
+  ObjModule* module = getModule(vm, name);
+  if (module == NULL) module = newModule(vm, name);
+
   ObjFn* fn = wrenCompile(vm, module, source, isExpression, printErrors);
   if (fn == NULL)
   {
@@ -664,8 +670,8 @@ static void createForeign(WrenVM* vm, ObjFiber* fiber, Value* stack)
   int symbol = wrenSymbolTableFind(&vm->methodNames, "<allocate>", 10);
   ASSERT(symbol != -1, "Should have defined <allocate> symbol.");
 
-  ASSERT(classObj->methods.count > symbol, "Class should have allocator.");
-  Method* method = &classObj->methods.data[symbol];
+  Method* method = wrenGetClassMethod(classObj, symbol);
+  ASSERT(method != NULL, "Class should have allocator.");
   ASSERT(method->type == METHOD_FOREIGN, "Allocator should be foreign.");
 
   // Pass the constructor arguments to the allocator as well.
@@ -688,10 +694,8 @@ void wrenFinalizeForeign(WrenVM* vm, ObjForeign* foreign)
 
   // If the class doesn't have a finalizer, bail out.
   ObjClass* classObj = foreign->obj.classObj;
-  if (symbol >= classObj->methods.count) return;
-
-  Method* method = &classObj->methods.data[symbol];
-  if (method->type == METHOD_NONE) return;
+  Method* method = wrenGetClassMethod(classObj, symbol);
+  if (method == NULL) return;
 
   ASSERT(method->type == METHOD_FOREIGN, "Finalizer should be foreign.");
 
@@ -1033,10 +1037,103 @@ static WrenInterpretResult runInterpreter(WrenVM* vm, register ObjFiber* fiber)
       classObj = AS_CLASS(fn->constants.data[READ_SHORT()]);
       goto completeCall;
 
+    // Arithmetic and comparisons of two numbers are done right here, as the
+    // Num primitives would, anything else calls the operator method.
+    #define NUM_OPERATOR(code, type, op)                                       \
+      CASE_CODE(code):                                                         \
+        if (IS_NUM(PEEK2()) && IS_NUM(PEEK()))                                 \
+        {                                                                      \
+          double right = AS_NUM(PEEK());                                       \
+          DROP();                                                              \
+          fiber->stackTop[-1] = type(AS_NUM(PEEK()) op right);                 \
+          ip += 2;                                                             \
+          DISPATCH();                                                          \
+        }                                                                      \
+        goto binaryCall
+
+    NUM_OPERATOR(ADD, NUM_VAL, +);
+    NUM_OPERATOR(SUB, NUM_VAL, -);
+    NUM_OPERATOR(MUL, NUM_VAL, *);
+    NUM_OPERATOR(DIV, NUM_VAL, /);
+    NUM_OPERATOR(LT, BOOL_VAL, <);
+    NUM_OPERATOR(LTE, BOOL_VAL, <=);
+    NUM_OPERATOR(GT, BOOL_VAL, >);
+    NUM_OPERATOR(GTE, BOOL_VAL, >=);
+    NUM_OPERATOR(EQ, BOOL_VAL, ==);
+    NUM_OPERATOR(NEQ, BOOL_VAL, !=);
+    #undef NUM_OPERATOR
+
+    CASE_CODE(ITERATE):
+    {
+      Value* seq = &stackStart[READ_BYTE()];
+      if (IS_RANGE(seq[0]) && (IS_NULL(seq[1]) || IS_NUM(seq[1])))
+      {
+        // Step the range here, the same as Range.iterate(_) would.
+        ObjRange* range = AS_RANGE(seq[0]);
+        ip += 2;
+        if (range->from == range->to && !range->isInclusive)
+        {
+          PUSH(FALSE_VAL);
+          DISPATCH();
+        }
+
+        if (IS_NULL(seq[1]))
+        {
+          PUSH(NUM_VAL(range->from));
+          DISPATCH();
+        }
+
+        double iterator = AS_NUM(seq[1]);
+        bool done;
+        if (range->from < range->to)
+        {
+          iterator++;
+          done = iterator > range->to;
+        }
+        else
+        {
+          iterator--;
+          done = iterator < range->to;
+        }
+
+        if (!range->isInclusive && iterator == range->to) done = true;
+        PUSH(done ? FALSE_VAL : NUM_VAL(iterator));
+        DISPATCH();
+      }
+
+      PUSH(seq[0]);
+      PUSH(seq[1]);
+      goto binaryCall;
+    }
+
+    CASE_CODE(ITERATOR_VALUE):
+    {
+      Value* seq = &stackStart[READ_BYTE()];
+      if (IS_RANGE(seq[0]))
+      {
+        // A range's iterator is its value.
+        ip += 2;
+        PUSH(seq[1]);
+        DISPATCH();
+      }
+
+      PUSH(seq[0]);
+      PUSH(seq[1]);
+      goto binaryCall;
+    }
+
+    // Calls method symbol [arg] with the two values on top of the stack, for the
+    // instructions above that only sometimes need a real call.
+    binaryCall:
+      numArgs = 2;
+      symbol = READ_SHORT();
+      args = fiber->stackTop - numArgs;
+      classObj = wrenGetClassInline(vm, args[0]);
+      goto completeCall;
+
     completeCall:
       // If the class's method table doesn't include the symbol, bail.
-      if (symbol >= classObj->methods.count ||
-          (method = &classObj->methods.data[symbol])->type == METHOD_NONE)
+      if ((method = wrenGetClassMethod(classObj, symbol)) == NULL)
       {
         methodNotFound(vm, classObj, symbol);
         RUNTIME_ERROR();
@@ -1074,8 +1171,11 @@ static WrenInterpretResult runInterpreter(WrenVM* vm, register ObjFiber* fiber)
           break;
 
         case METHOD_FOREIGN:
+          STORE_FRAME();
           callForeign(vm, fiber, method->as.foreign, numArgs);
           if (wrenHasError(fiber)) RUNTIME_ERROR();
+          // wrenEnsureSlots() may have grown the stack, which moves it.
+          LOAD_FRAME();
           break;
 
         case METHOD_BLOCK:
@@ -1648,7 +1748,11 @@ void wrenEnsureSlots(WrenVM* vm, int numSlots)
   int needed = (int)(vm->apiStack - vm->fiber->stack) + numSlots;
   wrenEnsureStack(vm, vm->fiber, needed);
   
-  vm->fiber->stackTop = vm->apiStack + numSlots;
+  // The new slots may hold stale values from earlier calls, which the GC would
+  // otherwise trace once they are below stackTop.
+  Value* top = vm->apiStack + numSlots;
+  for (Value* slot = vm->fiber->stackTop; slot < top; slot++) *slot = NULL_VAL;
+  vm->fiber->stackTop = top;
 }
 
 // Ensures that [slot] is a valid index into the API's stack of slots.
@@ -1673,6 +1777,50 @@ WrenType wrenGetSlotType(WrenVM* vm, int slot)
   return WREN_TYPE_UNKNOWN;
 }
 
+const char* wrenGetSlotClassName(WrenVM* vm, int slot)
+{
+  validateApiSlot(vm, slot);
+
+  ObjClass* classObj = wrenGetClassInline(vm, vm->apiStack[slot]);
+  return classObj->name->value;
+}
+
+void wrenGetSlotClass(WrenVM* vm, int slot, int classSlot)
+{
+  validateApiSlot(vm, slot);
+  validateApiSlot(vm, classSlot);
+
+  vm->apiStack[classSlot] = OBJ_VAL(wrenGetClassInline(vm, vm->apiStack[slot]));
+}
+
+const void* wrenGetSlotClassIdentity(WrenVM* vm, int slot)
+{
+  validateApiSlot(vm, slot);
+
+  return wrenGetClassInline(vm, vm->apiStack[slot]);
+}
+
+const void* wrenGetSlotIdentity(WrenVM* vm, int slot)
+{
+  validateApiSlot(vm, slot);
+
+  if (!IS_OBJ(vm->apiStack[slot])) return NULL;
+  return AS_OBJ(vm->apiStack[slot]);
+}
+
+bool wrenHasMethod(WrenVM* vm, int slot, const char* signature)
+{
+  ASSERT(signature != NULL, "Signature cannot be NULL.");
+  validateApiSlot(vm, slot);
+
+  int symbol = wrenSymbolTableFind(&vm->methodNames,
+                                   signature, strlen(signature));
+  if (symbol == -1) return false;
+
+  ObjClass* classObj = wrenGetClassInline(vm, vm->apiStack[slot]);
+  return wrenGetClassMethod(classObj, symbol) != NULL;
+}
+
 bool wrenGetSlotBool(WrenVM* vm, int slot)
 {
   validateApiSlot(vm, slot);
@@ -1708,6 +1856,19 @@ void* wrenGetSlotForeign(WrenVM* vm, int slot)
   return AS_FOREIGN(vm->apiStack[slot])->data;
 }
 
+bool wrenGetSlotRange(WrenVM* vm, int slot, double* from, double* to,
+                      bool* isInclusive)
+{
+  validateApiSlot(vm, slot);
+  if (!IS_RANGE(vm->apiStack[slot])) return false;
+
+  ObjRange* range = AS_RANGE(vm->apiStack[slot]);
+  *from = range->from;
+  *to = range->to;
+  *isInclusive = range->isInclusive;
+  return true;
+}
+
 const char* wrenGetSlotString(WrenVM* vm, int slot)
 {
   validateApiSlot(vm, slot);
@@ -1843,6 +2004,59 @@ void wrenInsertInList(WrenVM* vm, int listSlot, int index, int elementSlot)
   wrenListInsert(vm, list, vm->apiStack[elementSlot], index);
 }
 
+void wrenReserveList(WrenVM* vm, int slot, int capacity)
+{
+  validateApiSlot(vm, slot);
+  ASSERT(IS_LIST(vm->apiStack[slot]), "Slot must hold a list.");
+  ASSERT(capacity >= 0, "Capacity cannot be negative.");
+
+  ValueBuffer* elements = &AS_LIST(vm->apiStack[slot])->elements;
+  if ((uint32_t)capacity <= (uint32_t)elements->capacity) return;
+
+  elements->data = (Value*)wrenReallocate(vm, elements->data,
+      elements->capacity * sizeof(Value), capacity * sizeof(Value));
+  elements->capacity = capacity;
+}
+
+void wrenGetListElements(WrenVM* vm, int listSlot, int index, int count,
+                         int firstSlot)
+{
+  validateApiSlot(vm, listSlot);
+  ASSERT(IS_LIST(vm->apiStack[listSlot]), "Slot must hold a list.");
+  if (count <= 0) return;
+  validateApiSlot(vm, firstSlot);
+  validateApiSlot(vm, firstSlot + count - 1);
+
+  ValueBuffer elements = AS_LIST(vm->apiStack[listSlot])->elements;
+  ASSERT(index >= 0 && index + count <= elements.count, "Range out of bounds.");
+
+  memcpy(&vm->apiStack[firstSlot], &elements.data[index], count * sizeof(Value));
+}
+
+void wrenSetListElements(WrenVM* vm, int listSlot, int index, int count,
+                         int firstSlot)
+{
+  validateApiSlot(vm, listSlot);
+  ASSERT(IS_LIST(vm->apiStack[listSlot]), "Slot must hold a list.");
+  if (count <= 0) return;
+  validateApiSlot(vm, firstSlot);
+  validateApiSlot(vm, firstSlot + count - 1);
+
+  ValueBuffer* elements = &AS_LIST(vm->apiStack[listSlot])->elements;
+  ASSERT(index >= 0 && index <= elements->count, "Index out of bounds.");
+
+  int end = index + count;
+  if (end > elements->capacity)
+  {
+    // Grow geometrically so repeated appends stay amortized.
+    int capacity = wrenPowerOf2Ceil(end);
+    wrenReserveList(vm, listSlot, capacity);
+  }
+
+  memcpy(&elements->data[index], &vm->apiStack[firstSlot], count * sizeof(Value));
+  if (end > elements->count) elements->count = end;
+}
+
 int wrenGetMapCount(WrenVM* vm, int slot)
 {
   validateApiSlot(vm, slot);
@@ -1852,6 +2066,34 @@ int wrenGetMapCount(WrenVM* vm, int slot)
   return map->count;
 }
 
+int wrenGetMapCapacity(WrenVM* vm, int slot)
+{
+  validateApiSlot(vm, slot);
+  ASSERT(IS_MAP(vm->apiStack[slot]), "Slot must hold a map.");
+
+  ObjMap* map = AS_MAP(vm->apiStack[slot]);
+  return map->capacity;
+}
+
+bool wrenGetMapEntry(WrenVM* vm, int mapSlot, int index, int keySlot,
+                     int valueSlot)
+{
+  validateApiSlot(vm, mapSlot);
+  validateApiSlot(vm, keySlot);
+  validateApiSlot(vm, valueSlot);
+  ASSERT(IS_MAP(vm->apiStack[mapSlot]), "Slot must hold a map.");
+
+  ObjMap* map = AS_MAP(vm->apiStack[mapSlot]);
+  ASSERT(index >= 0 && (uint32_t)index < map->capacity, "Index out of bounds.");
+
+  MapEntry* entry = &map->entries[index];
+  if (IS_UNDEFINED(entry->key)) return false;
+
+  vm->apiStack[keySlot] = entry->key;
+  vm->apiStack[valueSlot] = entry->value;
+  return true;
+}
+
 bool wrenGetMapContainsKey(WrenVM* vm, int mapSlot, int keySlot)
 {
   validateApiSlot(vm, mapSlot);
@@ -1976,6 +2218,114 @@ bool wrenHasModule(WrenVM* vm, const char* module)
   return moduleObj != NULL;
 }
 
+WrenHandle* wrenGetModuleHandle(WrenVM* vm, const char* module)
+{
+  ASSERT(module != NULL, "Module cannot be NULL.");
+
+  Value moduleName = wrenStringFormat(vm, "$", module);
+  wrenPushRoot(vm, AS_OBJ(moduleName));
+
+  ObjModule* moduleObj = getModule(vm, moduleName);
+
+  wrenPopRoot(vm); // moduleName.
+
+  if (moduleObj == NULL) return NULL;
+  return wrenMakeHandle(vm, OBJ_VAL(moduleObj));
+}
+
+int wrenGetVariableIndex(WrenVM* vm, WrenHandle* module, const char* name)
+{
+  ASSERT(module != NULL, "Module cannot be NULL.");
+  ASSERT(wrenIsObjType(module->value, OBJ_MODULE), "Handle must hold a module.");
+  ASSERT(name != NULL, "Variable name cannot be NULL.");
+
+  ObjModule* moduleObj = AS_MODULE(module->value);
+  return wrenSymbolTableFind(&moduleObj->variableNames, name, strlen(name));
+}
+
+void wrenGetVariableAt(WrenVM* vm, WrenHandle* module, int index, int slot)
+{
+  ASSERT(module != NULL, "Module cannot be NULL.");
+  ASSERT(wrenIsObjType(module->value, OBJ_MODULE), "Handle must hold a module.");
+
+  ObjModule* moduleObj = AS_MODULE(module->value);
+  ASSERT(index >= 0 && index < moduleObj->variables.count,
+         "Variable index out of bounds.");
+
+  setSlot(vm, slot, moduleObj->variables.data[index]);
+}
+
+void wrenSetVariableAt(WrenVM* vm, WrenHandle* module, int index, int slot)
+{
+  ASSERT(module != NULL, "Module cannot be NULL.");
+  ASSERT(wrenIsObjType(module->value, OBJ_MODULE), "Handle must hold a module.");
+  validateApiSlot(vm, slot);
+
+  ObjModule* moduleObj = AS_MODULE(module->value);
+  ASSERT(index >= 0 && index < moduleObj->variables.count,
+         "Variable index out of bounds.");
+
+  moduleObj->variables.data[index] = vm->apiStack[slot];
+}
+
+bool wrenSetModuleVariable(WrenVM* vm, const char* module, const char* name,
+                           WrenHandle* value)
+{
+  ASSERT(name != NULL, "Variable name cannot be NULL.");
+  ASSERT(value != NULL, "Value cannot be NULL.");
+
+  ObjModule* moduleObj;
+  if (module == NULL)
+  {
+    moduleObj = getModule(vm, NULL_VAL);
+
+    // Core variables are copied into a module when it is made, so hand this
+    // one to the modules that already exist as well. One that has its own
+    // variable by that name, rather than a copy of the old core value, keeps
+    // it.
+    size_t length = strlen(name);
+    int symbol = wrenSymbolTableFind(&moduleObj->variableNames, name, length);
+    Value old = symbol == -1 ? UNDEFINED_VAL : moduleObj->variables.data[symbol];
+    for (uint32_t i = 0; i < vm->modules->capacity; i++)
+    {
+      MapEntry* entry = &vm->modules->entries[i];
+      if (IS_UNDEFINED(entry->key) || IS_NULL(entry->key)) continue;
+
+      ObjModule* each = AS_MODULE(entry->value);
+      int at = wrenSymbolTableFind(&each->variableNames, name, length);
+      if (at == -1)
+      {
+        wrenDefineVariable(vm, each, name, length, value->value, NULL);
+      }
+      else if (wrenValuesSame(each->variables.data[at], old))
+      {
+        each->variables.data[at] = value->value;
+      }
+    }
+  }
+  else
+  {
+    Value moduleName = wrenStringFormat(vm, "$", module);
+    wrenPushRoot(vm, AS_OBJ(moduleName));
+
+    moduleObj = getModule(vm, moduleName);
+    if (moduleObj == NULL) moduleObj = newModule(vm, moduleName);
+
+    wrenPopRoot(vm); // moduleName.
+  }
+
+  int symbol = wrenSymbolTableFind(&moduleObj->variableNames,
+                                   name, strlen(name));
+  if (symbol != -1)
+  {
+    moduleObj->variables.data[symbol] = value->value;
+    return true;
+  }
+
+  return wrenDefineVariable(vm, moduleObj, name, strlen(name), value->value,
+                            NULL) >= 0;
+}
+
 void wrenAbortFiber(WrenVM* vm, int slot)
 {
   validateApiSlot(vm, slot);
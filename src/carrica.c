@@ -8,7 +8,16 @@
 */
 
 #include "vm.h"
+#include "cls_vector.h"
+#include "cls_typed.h"
+#include "cls_struct.h"
+#include "cls_bind.h"
+#include "cls_host.h"
+#include "cls_object.h"
+#include <limits.h>
+#include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 
@@ -21,6 +30,7 @@ typedef struct _sharedModule {
 static lua_State *mstate;
 static int mEmitRef = -1;
 static int mSortRef = -1;
+static bool mSortCustom = false;
 static char emitBuffer[256];
 static sharedModule *smodEntry = NULL;
 
@@ -37,14 +47,73 @@ WrenHandle* lcvmGetClassHandle(carricaVM *cvm, const char* module, const char* n
 	return wrenGetSlotHandle(cvm->vm, 0);
 }
 
+// ********************************************************************************
+// the change journal, shared by Tables and Arrays
+
+static const char *lcJournalOps[] = { "", "set", "remove", "insert" };
+
+// ref:journal(true | false | size)
+static int lcJournal(lua_State* L, vmWrenReference *ref) {
+	vmJournalFree(ref);
+	if (!lua_toboolean(L, 2)) return 0;
+	lua_Number size = lua_isnumber(L, 2) ? lua_tonumber(L, 2) : VM_JOURNAL_SIZE;
+	if (!(size >= 1)) luaL_error(L, "carrica -> journal() size must be at least 1");
+	if ((size > INT_MAX) || (size > SIZE_MAX / sizeof(vmJournalEntry)))
+		luaL_error(L, "carrica -> journal() size is too big");
+	vmJournal *j = malloc(sizeof(vmJournal));
+	vmJournalEntry *entry = malloc(sizeof(vmJournalEntry) * (size_t)size);
+	if ((j == NULL) || (entry == NULL)) {
+		free(j);
+		free(entry);
+		luaL_error(L, "carrica -> out of memory for a %d record journal()", (int)size);
+	}
+	j->count = 0;
+	j->capacity = (int)size;
+	j->reset = false;
+	j->entry = entry;
+	ref->journal = j;
+	return 0;
+}
+
+// ref:changes() returns { key, op, key, op, ... }, reset and empties the
+// journal, reset means lua should look at everything as we lost track
+static int lcChanges(lua_State* L, vmWrenReference *ref) {
+	vmJournal *j = ref->journal;
+	if (j == NULL) luaL_error(L, "carrica -> changes() called without journal() turned on");
+	lua_createtable(L, j->count * 2, 0);
+	for (int i = 0; i < j->count; i++) {
+		vmJournalEntry *e = &j->entry[i];
+		if (e->key.type == LUA_TNUMBER) {
+			lua_pushnumber(L, e->key.as.n);
+		} else {
+			lua_pushlstring(L, e->key.as.s, e->key.len);
+			free(e->key.as.s);
+		}
+		lua_rawseti(L, -2, i * 2 + 1);
+		lua_pushstring(L, lcJournalOps[e->op]);
+		lua_rawseti(L, -2, i * 2 + 2);
+	}
+	lua_pushboolean(L, j->reset);
+	j->count = 0;
+	j->reset = false;
+	return 2;
+}
+
 int lctGC(lua_State* L) {
 	vmWrenReference *ref = luaL_checkudata(L, 1, LUA_NAME_STABLE);
 	ref->refCount--;
 	if (ref->refCount == 0) {
 		// remove the underlying table
+		vmRefDrop(ref);
+		vmJournalFree(ref);
 		lua_pushlightuserdata(L, ref);
 		lua_pushnil(L);
 		lua_settable(L, LUA_REGISTRYINDEX);
+		if (ref->cursors) {
+			lua_pushlightuserdata(L, &ref->cursors);
+			lua_pushnil(L);
+			lua_settable(L, LUA_REGISTRYINDEX);
+		}
 		// release the wren handle
 		wrenReleaseHandle(ref->cvm->vm, ref->handle);
 	}
@@ -53,6 +122,9 @@ int lctGC(lua_State* L) {
 
 int lctRef(lua_State* L) {
 	vmWrenReference *ref = luaL_checkudata(L, 1, LUA_NAME_STABLE);
+	// lua can write to the raw table now, so the count is only a hint
+	vmRefOwn(ref);
+	ref->exposed = true;
 	lua_pushlightuserdata(L, ref);
 	lua_gettable(L, LUA_REGISTRYINDEX);
 	return 1;
@@ -61,6 +133,8 @@ int lctRef(lua_State* L) {
 int lctSetRef(lua_State* L) {
 	vmWrenReference *ref = luaL_checkudata(L, 1, LUA_NAME_STABLE);
 	if (lua_type(L, 2) != LUA_TTABLE) luaL_error(L, "table.setRef() only accepts a table argument");
+	vmRefDrop(ref);
+	ref->exposed = true;
 	lua_pushlightuserdata(L, ref);
 	lua_pushvalue(L, 2);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -79,11 +153,21 @@ int lctRelease(lua_State* L) {
 	return 0;
 }
 
+int lctJournal(lua_State* L) {
+	return lcJournal(L, luaL_checkudata(L, 1, LUA_NAME_STABLE));
+}
+
+int lctChanges(lua_State* L) {
+	return lcChanges(L, luaL_checkudata(L, 1, LUA_NAME_STABLE));
+}
+
 luaL_Reg lctfunc[] = {
 	{ "ref", lctRef },
 	{ "setRef", lctSetRef },
 	{ "hold", lctHold },
 	{ "release", lctRelease },
+	{ "journal", lctJournal },
+	{ "changes", lctChanges },
 	{ NULL, NULL }
 };
 
@@ -92,9 +176,14 @@ int lcaGC(lua_State* L) {
 	ref->refCount--;
 	if (ref->refCount == 0) {
 		// remove the underlying table
+		vmRefDrop(ref);
+		vmJournalFree(ref);
 		lua_pushlightuserdata(L, ref);
 		lua_pushnil(L);
 		lua_settable(L, LUA_REGISTRYINDEX);
+		lua_pushlightuserdata(L, &ref->indexed);
+		lua_pushnil(L);
+		lua_settable(L, LUA_REGISTRYINDEX);
 		// release the wren handle
 		wrenReleaseHandle(ref->cvm->vm, ref->handle);
 	}
@@ -103,6 +192,9 @@ int lcaGC(lua_State* L) {
 
 int lcaRef(lua_State* L) {
 	vmWrenReference *ref = luaL_checkudata(L, 1, LUA_NAME_SARRAY);
+	// lua can write to the raw table now, so it can't be shared with clones
+	vmRefOwn(ref);
+	ref->exposed = true;
 	lua_pushlightuserdata(L, ref);
 	lua_gettable(L, LUA_REGISTRYINDEX);
 	return 1;
@@ -111,6 +203,9 @@ int lcaRef(lua_State* L) {
 int lcaSetRef(lua_State* L) {
 	vmWrenReference *ref = luaL_checkudata(L, 1, LUA_NAME_SARRAY);
 	if (lua_type(L, 2) != LUA_TTABLE) luaL_error(L, "table.setRef() only accepts a table argument");
+	vmRefDrop(ref);
+	ref->exposed = true;
+	ref->indexed = false;
 	lua_pushlightuserdata(L, ref);
 	lua_pushvalue(L, 2);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -129,12 +224,57 @@ int lcaRelease(lua_State* L) {
 	return 0;
 }
 
+int lcaJournal(lua_State* L) {
+	return lcJournal(L, luaL_checkudata(L, 1, LUA_NAME_SARRAY));
+}
+
+int lcaChanges(lua_State* L) {
+	return lcChanges(L, luaL_checkudata(L, 1, LUA_NAME_SARRAY));
+}
 
 luaL_Reg lcafunc[] = {
 	{ "ref", lcaRef },
 	{ "setRef", lcaSetRef },
 	{ "hold", lcaHold },
 	{ "release", lcaRelease },
+	{ "journal", lcaJournal },
+	{ "changes", lcaChanges },
+	{ NULL, NULL }
+};
+
+// an Array view in lua is a proxy, index it like the table it stands in for
+int lcvIndex(lua_State* L) {
+	vmArrayView *v = luaL_checkudata(L, 1, LUA_NAME_SVIEW);
+	int i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : 0;
+	if ((i < 1) || (i > v->length)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_getfenv(L, 1);
+	lua_rawgeti(L, -1, v->offset + i);
+	return 1;
+}
+
+int lcvNewIndex(lua_State* L) {
+	vmArrayView *v = luaL_checkudata(L, 1, LUA_NAME_SVIEW);
+	int i = luaL_checkint(L, 2);
+	if ((i < 1) || (i > v->length)) luaL_error(L, "index out of bounds on Array view");
+	lua_getfenv(L, 1);
+	lua_pushvalue(L, 3);
+	lua_rawseti(L, -2, v->offset + i);
+	return 0;
+}
+
+int lcvLen(lua_State* L) {
+	vmArrayView *v = luaL_checkudata(L, 1, LUA_NAME_SVIEW);
+	lua_pushinteger(L, v->length);
+	return 1;
+}
+
+luaL_Reg lcvfunc[] = {
+	{ "__index", lcvIndex },
+	{ "__newindex", lcvNewIndex },
+	{ "__len", lcvLen },
 	{ NULL, NULL }
 };
 
@@ -314,6 +454,41 @@ int lcvmHasModule(lua_State* L) {
 	return 1;
 }
 
+// vm:setOutput(mode, size, fd), mode is "direct", "line" or "buffer", size the
+// bytes held when buffering and fd a file descriptor to write to instead of lua
+int lcvmSetOutput(lua_State* L) {
+	static const char *modes[] = { "direct", "line", "buffer", NULL };
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".setOutput()");
+	int mode = luaL_checkoption(L, 2, "direct", modes);
+	lua_Number size = luaL_optnumber(L, 3, VM_OUTPUT_SIZE);
+	int fd = luaL_optinteger(L, 4, -1);
+	if (!(size >= 1)) luaL_error(L, "carrica -> .setOutput() size must be at least 1");
+	if (size > INT_MAX) luaL_error(L, "carrica -> .setOutput() size is too big");
+	if (!vmSetOutput(cvm, mode, (int)size, fd))
+		luaL_error(L, "carrica -> out of memory for a %d byte output buffer in .setOutput()", (int)size);
+	return 0;
+}
+
+int lcvmFlush(lua_State* L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".flush()");
+	vmFlushOutput(cvm);
+	return 0;
+}
+
+// vm:define(module, name, value), a top level variable in module before it compiles
+int lcvmDefine(lua_State* L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".define()");
+	const char *module = luaL_checkstring(L, 2);
+	const char *name = luaL_checkstring(L, 3);
+	lua_settop(L, 4);
+	if (!vmDefineVariable(cvm, module, name, 4))
+		luaL_error(L, "carrica -> .define() value must be nil, a boolean, number, string, Array, Table or Wren object");
+	return 0;
+}
+
 int lcvmGC(lua_State* L) {
 	carricaVM *vm = lua_touserdata(L, 1);
 	vmRelease(vm);
@@ -326,6 +501,13 @@ int lcvmNewArray(lua_State* L) {
 	ref->type = VM_WREN_SHARE_ARRAY;
 	ref->refCount = 1;
 	ref->cvm = cvm;
+	ref->count = 0;
+	ref->epoch = 0;
+	ref->exposed = false;
+	ref->shared = NULL;
+	ref->journal = NULL;
+	ref->indexed = false;
+	ref->cursors = false;
 	lua_pushlightuserdata(L, ref);
 	lua_newtable(L);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -351,6 +533,13 @@ int lcvmNewTable(lua_State* L) {
 	ref->type = VM_WREN_SHARE_TABLE;
 	ref->refCount = 1;
 	ref->cvm = cvm;
+	ref->count = 0;
+	ref->epoch = 0;
+	ref->exposed = false;
+	ref->shared = NULL;
+	ref->journal = NULL;
+	ref->indexed = false;
+	ref->cursors = false;
 	lua_pushlightuserdata(L, ref);
 	lua_newtable(L);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -377,19 +566,28 @@ int lcvmSetWrenName(lua_State* L) {
 	return 0;
 }
 
-// NYI
+// vm:getClassObj(module, className), the class as a Wren object lua can call
+// static methods and constructors on, obj:new(...) hands back the instance
 int lcvmGetClass(lua_State* L) {
 	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
 	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".getClassObj()");
-	luaL_error(L, "carrica -> vm.getClassObj() not yet implemented");
-	return 0;
+	const char *module = luaL_checkstring(L, 2);
+	const char *name = luaL_checkstring(L, 3);
+	if (!vmHasModule(cvm, module) || !vmHasVariable(cvm, module, name))
+		luaL_error(L, "carrica -> could not find class '%s' in module '%s'", name, module);
+	wrenEnsureSlots(cvm->vm, 1);
+	wrenGetVariable(cvm->vm, module, name, 0);
+	ovmLuaPush(cvm, 0);
+	return 1;
 }
 
-/// NYI
+// vm:freeClassObj(obj), let go of any Wren object now rather than when lua collects it
 int lcvmFreeClass(lua_State* L) {
 	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
 	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".freeClassObj()");
-	luaL_error(L, "carrica -> vm.freeClassObj() not yet implemented");
+	vmWrenObject *o = ovmLuaTest(L, 2);
+	if (o == NULL) luaL_argerror(L, 2, "a Wren object");
+	ovmFree(o);
 	return 0;
 }
 
@@ -403,15 +601,23 @@ luaL_Reg lcvmfunc[] = {
 	{ "setWrenName", lcvmSetWrenName },			// set a function that gets called when a module needs loaded
 	{ "handler", lcvmHandler },					// set handlers for this VM
 	{ "interpret", lcvmInterpret },				// interpret code in the VM
+	{ "define", lcvmDefine },					// define a top level variable in a module
+	{ "setOutput", lcvmSetOutput },				// choose how Wren's output is buffered and where it goes
+	{ "flush", lcvmFlush },						// send any output being held
 	{ "getMethod", lcvmGetMethod },				// get a method as a lua function
 	{ "freeMethod", lcvmFreeMethod },			// get a method as a lua function
+	{ "getVariableHandle", ovmLuaGetVariableHandle },	// find a top level variable once, to get and set
+	{ "getVariables", ovmLuaGetVariables },		// read a list of top level variables at once
 	{ "hasVariable", lcvmHasVariable },			// VM has a variable (top level)
 	{ "hasModule", lcvmHasModule },				// VM has a given module
 	{ "newArray", lcvmNewArray },				// create a new shared array
 	{ "newTable", lcvmNewTable },				// create a new shared table
+	{ "drainCommands", hvmLuaDrain },			// make the calls Wren queued with Host.post()
 	// higher level magicks
-	{ "getClassObj", lcvmGetClass },			// get a 'proper' class object from the VM
-	{ "freeClassObj", lcvmFreeClass },			// free a 'proper' class object from the VM
+	{ "bindClass", bvmLuaBindClass },			// bind a table of lua functions as a Wren class
+	{ "defineLuaClass", bvmLuaDefineClass },	// a Wren class with a lua object behind each instance
+	{ "getClassObj", lcvmGetClass },			// get a class as a Wren object lua can call methods on
+	{ "freeClassObj", lcvmFreeClass },			// let go of a Wren object lua holds
     { NULL, NULL }
 };
 
@@ -478,6 +684,15 @@ int lcSetDebugEmit(lua_State *L) {
 	return 0;
 }
 
+// carrica.defineShared(name, value), a variable every module of every VM sees
+int lcDefineShared(lua_State *L) {
+	const char *name = luaL_checkstring(L, 1);
+	lua_settop(L, 2);
+	if (!vmDefineShared(L, name, 2))
+		luaL_error(L, "carrica -> .defineShared() value must be nil, a boolean, number or string");
+	return 0;
+}
+
 int lcInstallModule(lua_State *L) {
 	const char *name = strdup(luaL_checkstring(L, 1));
 	const char *source = strdup(luaL_checkstring(L, 2));
@@ -498,6 +713,7 @@ int lcSetSortFunc(lua_State *L) {
 		lua_pushlightuserdata(L, &mSortRef);
 		lua_pushvalue(L, -2);
 		lua_settable(L, LUA_REGISTRYINDEX);
+		mSortCustom = true;
 	} else {
 		luaL_error(L, "carrica -> .setSortFunc() passed a non-function parameter");
 	}
@@ -515,6 +731,8 @@ int lcSetDefaultWrenName(lua_State *L) {
 }
 
 luaL_Reg lfunc[] = {
+	{ "defineShared", lcDefineShared },			// define a constant for every module of all VMs
+	{ "defineStruct", svmLuaDefine },			// define a struct shared by Wren and lua
 	{ "hasDebug", lcHasDebug },					// compiled with debug?
 	{ "installModule", lcInstallModule },		// install a shared source module for all VMs
 	{ "newVM", lcNewVM },						// create a new VM
@@ -549,6 +767,20 @@ int luaopen_carrica(lua_State* L) {
 	lua_newmeta(L, LUA_NAME_WRENVM, lcvmfunc, lcvmGC);
 	lua_newmeta(L, LUA_NAME_STABLE, lctfunc, lctGC);
 	lua_newmeta(L, LUA_NAME_SARRAY, lcafunc, lcaGC);
+	lua_newmeta(L, LUA_NAME_SVARIABLE, ovmVariableMeta, ovmLuaVariableGC);
+	// views, vectors, typed arrays and structs bring their own __index, so no lua_newmeta() here
+	luaL_newmetatable(L, LUA_NAME_SVIEW);
+	luaL_register(L, NULL, lcvfunc);
+	lua_pop(L, 1);
+	luaL_newmetatable(L, LUA_NAME_SVECTOR);
+	luaL_register(L, NULL, vvmLuaMeta);
+	lua_pop(L, 1);
+	luaL_newmetatable(L, LUA_NAME_STYPED);
+	luaL_register(L, NULL, tyvmLuaMeta);
+	lua_pop(L, 1);
+	luaL_newmetatable(L, LUA_NAME_SSTRUCT);
+	luaL_register(L, NULL, svmLuaMeta);
+	lua_pop(L, 1);
 	//lua_newmeta(L, LUA_NAME_S_UOBJ, lcufunc, lcuGC);
 	// a table for some internal data
 		lua_pushlightuserdata(L, &mEmitRef);
@@ -568,4 +800,6 @@ int luaopen_carrica(lua_State* L) {
 void lua_pushSortFunction(lua_State *L) {
 	lua_pushlightuserdata(L, &mSortRef);
 	lua_gettable(L, LUA_REGISTRYINDEX);
-}
\ No newline at end of file
+}
+
+bool lua_hasDefaultSortFunction() { return !mSortCustom; }
\ No newline at end of file
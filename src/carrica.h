@@ -19,9 +19,15 @@
 #define LUA_NAME_STABLE		"2-CARRCIA-STABLE"
 #define LUA_NAME_SARRAY		"3-CARRCIA-SARRAY"
 #define LUA_NAME_S_UOBJ		"3-CARRCIA-S_UOBJ"
+#define LUA_NAME_SVIEW		"4-CARRCIA-SVIEW"
+#define LUA_NAME_SVECTOR	"5-CARRCIA-SVECTOR"
+#define LUA_NAME_STYPED		"6-CARRCIA-STYPED"
+#define LUA_NAME_SSTRUCT	"7-CARRCIA-SSTRUCT"
+#define LUA_NAME_SVARIABLE	"8-CARRCIA-SVARIABLE"
 
 // the function that starts it all
 int luaopen_carrica(lua_State* L);
 
 // some shared functions
 void lua_pushSortFunction(lua_State *L);
+bool lua_hasDefaultSortFunction();
@@ -10,8 +10,13 @@
 
 #include "cls_array.h"
 #include "vm.h"
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define WERR(x) { wrenError(vm, x); return; }
+// the same, but first pop the table we pushed
+#define AERR(x) { lua_pop(cvm->L, 1); wrenError(vm, x); return; }
 
 vmWrenReference* avmLuaNewArray(carricaVM *cvm) {
 	lua_State *L = cvm->L;
@@ -19,6 +24,14 @@ vmWrenReference* avmLuaNewArray(carricaVM *cvm) {
 	ret->type = VM_WREN_SHARE_ARRAY;
 	ret->refCount = 1;
 	ret->cvm = cvm;
+	ret->handle = NULL;
+	ret->count = 0;
+	ret->epoch = 0;
+	ret->exposed = false;
+	ret->shared = NULL;
+	ret->journal = NULL;
+	ret->indexed = false;
+	ret->cursors = false;
 	lua_pushlightuserdata(L, ret);
 	lua_newtable(L);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -33,92 +46,399 @@ vmWrenReference* avmLuaNewArray(carricaVM *cvm) {
 	return ret;
 }
 
+// push the table behind an Array (or view) and return how many elements we
+// can see, element i (from 0) lives at base + i + 1 in the table
+int avmPushTable(carricaVM *cvm, vmWrenReReference *reref, int *base) {
+	lua_pushlightuserdata(cvm->L, reref->pref);
+	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	int len = lua_objlen(cvm->L, -1);
+	*base = 0;
+	if (reref->view) {
+		// the parent may have shrunk under us, so never look past it's end
+		*base = reref->offset;
+		len -= reref->offset;
+		if (len > reref->length) len = reref->length;
+		if (len < 0) len = 0;
+	}
+	return len;
+}
+
+// push a view to lua as a small proxy, the parent table rides along as it's
+// environment so lua reads and writes go straight through
+void avmLuaPushView(carricaVM *cvm, vmWrenReReference *reref) {
+	lua_State *L = cvm->L;
+	vmRefOwn(reref->pref);
+	vmArrayView *v = lua_newuserdata(L, VM_VIEW_SIZE);
+	v->offset = reref->offset;
+	v->length = reref->length;
+	luaL_getmetatable(L, LUA_NAME_SVIEW);
+	lua_setmetatable(L, -2);
+	lua_pushlightuserdata(L, reref->pref);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	lua_setfenv(L, -2);
+	reref->pref->exposed = true;
+}
+
+// replace the Array (or view) in slot 0 with a view of count elements from start
+static void avmNewView(WrenVM *vm, int start, int count) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	vmWrenReference *pref = reref->pref;
+	int offset = reref->offset + start;
+	wrenEnsureSlots(vm, 4);
+	if (cvm->handle.Array == NULL) cvm->handle.Array = lcvmGetClassHandle(cvm, "carrica", "Array");
+	wrenSetSlotHandle(vm, 3, cvm->handle.Array);
+	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 3, VM_REREF_SIZE);
+	ref->type = VM_WREN_SHARE_ARRAY;
+	ref->pref = pref;
+	ref->cvm = cvm;
+	ref->offset = offset;
+	ref->length = count;
+	ref->view = true;
+	// we hold the parent just like any other reference, avmFinalize lets go
+	pref->refCount++;
+}
+
+// note count elements written from lua index from in the journal, if it's on
+static void avmJournalRange(vmWrenReference *ref, int from, int count) {
+	if (ref->journal == NULL) return;
+	for (int i = 0; i < count; i++) vmJournalIndex(ref, VM_JOURNAL_SET, from + i);
+}
+
+// copy cnt elements of the Wren list in slot list into the table on top of the
+// stack after index pos, a chunk at a time through the slots after list
+static void avmFromWrenList(WrenVM *vm, carricaVM *cvm, int list, int cnt, int pos) {
+	wrenEnsureSlots(vm, list + VM_LIST_CHUNK + 1);
+	for (int i = 0; i < cnt; i += VM_LIST_CHUNK) {
+		int n = (cnt - i < VM_LIST_CHUNK) ? cnt - i : VM_LIST_CHUNK;
+		wrenGetListElements(vm, list, i, n, list + 1);
+		for (int j = 0; j < n; j++) {
+			luaPushFromWrenSlot(cvm, list + 1 + j);
+			lua_rawseti(cvm->L, -2, ++pos);
+		}
+	}
+}
+
+// write cnt elements of the table on top of the stack from base into the Wren
+// list in slot list starting at index pos, growing it if need be
+static void avmToWrenList(WrenVM *vm, carricaVM *cvm, int list, int pos, int base, int cnt) {
+	wrenEnsureSlots(vm, list + VM_LIST_CHUNK + 1);
+	for (int i = 0; i < cnt; i += VM_LIST_CHUNK) {
+		int n = (cnt - i < VM_LIST_CHUNK) ? cnt - i : VM_LIST_CHUNK;
+		for (int j = 0; j < n; j++) {
+			lua_rawgeti(cvm->L, -1, base + i + j + 1);
+			wrenSetSlotFromLua(cvm, list + 1 + j, -1);
+			lua_pop(cvm->L, 1);
+		}
+		wrenSetListElements(vm, list, pos + i, n, list + 1);
+	}
+}
+
+// ********************************************************************************
+// a lazy value -> first index hash behind indexOf(), contains() and remove(),
+// built the first time indexOf() or contains() runs on a big enough Array, kept
+// up to date by [_]=(_), add(), remove() and removeAt() and dropped by the other
+// writes, if lua may have written to the table since it gets built again
+
+// Arrays shorter than this are just scanned
+#define AVM_INDEX_MIN		16
+
+static bool avmIndexValid(vmWrenReference *ref) {
+	return ref->indexed && (!ref->exposed || (ref->indexEpoch == ref->cvm->luaEpoch));
+}
+
+static void avmIndexDrop(vmWrenReference *ref) {
+	if (!ref->indexed) return;
+	lua_State *L = ref->cvm->L;
+	lua_pushlightuserdata(L, &ref->indexed);
+	lua_pushnil(L);
+	lua_settable(L, LUA_REGISTRYINDEX);
+	ref->indexed = false;
+}
+
+// can this value be a key of the index? (not nil or NaN)
+static bool avmIndexable(lua_State *L, int idx) {
+	if (lua_isnil(L, idx)) return false;
+	if (lua_type(L, idx) == LUA_TNUMBER) {
+		lua_Number n = lua_tonumber(L, idx);
+		return n == n;
+	}
+	return true;
+}
+
+// push the index of the table at stack index t (absolute), building it if need be
+static void avmIndexPush(vmWrenReference *ref, lua_State *L, int t) {
+	lua_pushlightuserdata(L, &ref->indexed);
+	if (avmIndexValid(ref)) {
+		lua_gettable(L, LUA_REGISTRYINDEX);
+		return;
+	}
+	int len = lua_objlen(L, t);
+	lua_createtable(L, 0, len);
+	// walk backwards so the first index of a value is the one left standing
+	for (int i = len; i > 0; i--) {
+		lua_rawgeti(L, t, i);
+		if (avmIndexable(L, -1)) {
+			lua_pushinteger(L, i);
+			lua_rawset(L, -3);
+		} else
+			lua_pop(L, 1);
+	}
+	lua_pushvalue(L, -1);
+	lua_insert(L, -3);
+	lua_settable(L, LUA_REGISTRYINDEX);
+	ref->indexed = true;
+	ref->indexEpoch = ref->cvm->luaEpoch;
+}
+
+// the table at t is about to have the value at stack index val written at lua
+// index pos, which holds the value at stack index old (0 when nothing is there),
+// patch the index to match or drop it
+static void avmIndexWrite(vmWrenReference *ref, lua_State *L, int t, int pos, int val, int old) {
+	if (!avmIndexValid(ref)) {
+		avmIndexDrop(ref);
+		return;
+	}
+	avmIndexPush(ref, L, t);
+	if (old && avmIndexable(L, old)) {
+		// the first copy of old going away means looking for the next one
+		lua_pushvalue(L, old);
+		lua_rawget(L, -2);
+		bool first = (lua_tointeger(L, -1) == pos);
+		lua_pop(L, 1);
+		if (first) {
+			lua_pop(L, 1);
+			avmIndexDrop(ref);
+			return;
+		}
+	}
+	if (avmIndexable(L, val)) {
+		lua_pushvalue(L, val);
+		lua_rawget(L, -2);
+		int at = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		if ((at == 0) || (at > pos)) {
+			lua_pushvalue(L, val);
+			lua_pushinteger(L, pos);
+			lua_rawset(L, -3);
+		}
+	}
+	lua_pop(L, 1);
+}
+
+// the table at t (absolute) just had lua index pos taken out, the value at stack
+// index val, with the elements after it moved down one to leave len, patch the
+// index to match or drop it
+static void avmIndexRemove(vmWrenReference *ref, lua_State *L, int t, int pos, int val, int len) {
+	if (!avmIndexValid(ref)) {
+		avmIndexDrop(ref);
+		return;
+	}
+	avmIndexPush(ref, L, t);
+	int ix = lua_gettop(L);
+	// every value first seen after pos is one earlier now
+	lua_pushnil(L);
+	while (lua_next(L, ix)) {
+		int at = lua_tointeger(L, -1);
+		lua_pop(L, 1);
+		if (at > pos) {
+			lua_pushvalue(L, -1);
+			lua_pushinteger(L, at - 1);
+			lua_rawset(L, ix);
+		}
+	}
+	// and if that was the first copy of val, the next one (if any) takes over
+	if (avmIndexable(L, val)) {
+		lua_pushvalue(L, val);
+		lua_rawget(L, ix);
+		bool first = (lua_tointeger(L, -1) == pos);
+		lua_pop(L, 1);
+		if (first) {
+			int next = 0;
+			for (int i = pos; (i <= len) && (next == 0); i++) {
+				lua_rawgeti(L, t, i);
+				if (lua_rawequal(L, -1, val)) next = i;
+				lua_pop(L, 1);
+			}
+			lua_pushvalue(L, val);
+			if (next) lua_pushinteger(L, next);
+			else lua_pushnil(L);
+			lua_rawset(L, ix);
+		}
+	}
+	lua_pop(L, 1);
+}
+
+// make the Array ref hold the n values on the lua stack from first (absolute),
+// writing over the table it has so lua holding that sees them too
+void avmLuaReplace(carricaVM *cvm, vmWrenReference *ref, int first, int n) {
+	lua_State *L = cvm->L;
+	vmRefOwn(ref);
+	avmIndexDrop(ref);
+	vmJournalReset(ref);
+	lua_pushlightuserdata(L, ref);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	int t = lua_gettop(L);
+	for (int i = 0; i < n; i++) {
+		lua_pushvalue(L, first + i);
+		lua_rawseti(L, t, i + 1);
+	}
+	for (int i = lua_objlen(L, t); i > n; i--) {
+		lua_pushnil(L);
+		lua_rawseti(L, t, i);
+	}
+	lua_pop(L, 1);
+}
+
 void avmGet(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	double from, to;
+	bool inclusive;
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
 	if (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM) {
-		lua_pushinteger(cvm->L, (int)wrenGetSlotDouble(vm, 1) + 1);
-		lua_gettable(cvm->L, -2);
+		int i = (int)wrenGetSlotDouble(vm, 1);
+		if (reref->view && ((i < 0) || (i >= len)))
+			AERR("index out of bounds on Array view")
+		lua_rawgeti(cvm->L, -1, base + i + 1);
 		wrenSetSlotFromLua(cvm, 0, -1);
 		lua_pop(cvm->L, 2);
 		return;
-	} else 
-		wrenError(vm, "bad index passed to Array.get() numbers only");
+	} else if (wrenGetSlotRange(vm, 1, &from, &to, &inclusive)) {
+		// a range gives a view, following the same rules as List ranges
+		lua_pop(cvm->L, 1);
+		if ((from == len) && (to == (inclusive ? -1 : len))) {
+			avmNewView(vm, len, 0);
+			return;
+		}
+		if (from < 0) from += len;
+		if (to < 0) to += len;
+		if (!inclusive) to -= 1;
+		if ((from < 0) || (from >= len) || (to >= len) || (to < from - 1))
+			WERR("range out of bounds on Array[], views must be ascending")
+		avmNewView(vm, (int)from, (int)(to - from) + 1);
+		return;
+	} else
+		wrenError(vm, "bad index passed to Array.get() numbers or ranges only");
 	lua_pop(cvm->L, 1);
 }
 
 void avmSet(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	vmRefOwn(reref->pref);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
 	if (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM) {
-		lua_pushinteger(cvm->L, (int)wrenGetSlotDouble(vm, 1) + 1);
-		luaPushFromWrenSlot(cvm, 2);
-		lua_settable(cvm->L, -3);
+		int i = (int)wrenGetSlotDouble(vm, 1);
+		if (reref->view && ((i < 0) || (i >= len)))
+			AERR("index out of bounds on Array view")
+		int pos = base + i + 1;
+		if (reref->pref->indexed) {
+			if ((pos >= 1) && (pos <= (int)lua_objlen(cvm->L, -1) + 1)) {
+				int t = lua_gettop(cvm->L);
+				lua_rawgeti(cvm->L, t, pos);
+				luaPushFromWrenSlot(cvm, 2);
+				avmIndexWrite(reref->pref, cvm->L, t, pos, t + 2, t + 1);
+				lua_rawseti(cvm->L, t, pos);
+				lua_pop(cvm->L, 1);
+			} else {
+				avmIndexDrop(reref->pref);
+				luaPushFromWrenSlot(cvm, 2);
+				lua_rawseti(cvm->L, -2, pos);
+			}
+		} else {
+			luaPushFromWrenSlot(cvm, 2);
+			lua_rawseti(cvm->L, -2, pos);
+		}
+		vmJournalIndex(reref->pref, VM_JOURNAL_SET, pos);
 	} else
 		wrenError(vm, "bad index passed to Array.set() numbers only");
-	lua_pop(cvm->L, 1);	
+	lua_pop(cvm->L, 1);
+}
+
+void avmView(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("bad parameters passed to Array.view(), numbers expected")
+	int start = (int)wrenGetSlotDouble(vm, 1);
+	int count = (int)wrenGetSlotDouble(vm, 2);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
+	lua_pop(cvm->L, 1);
+	if ((start < 0) || (count < 0) || (start + count > len))
+		WERR("view out of bounds on Array.view()")
+	avmNewView(vm, start, count);
+}
+
+void avmIsView(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	wrenSetSlotBool(vm, 0, reref->view);
 }
 
 void avmClear(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.clear() can not be called on a view")
+	vmRefDrop(reref->pref);
+	avmIndexDrop(reref->pref);
+	vmJournalReset(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_newtable(cvm->L);
-	lua_settable(cvm->L, LUA_REGISTRYINDEX);	
+	lua_settable(cvm->L, LUA_REGISTRYINDEX);
 }
 
 void avmCount(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	wrenSetSlotDouble(vm, 0, lua_objlen(cvm->L, -1));
-	lua_pop(cvm->L, 1);	
+	int base;
+	wrenSetSlotDouble(vm, 0, avmPushTable(cvm, reref, &base));
+	lua_pop(cvm->L, 1);
 }
 
 void avmFilled(WrenVM *vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
 	if (cvm->handle.Array == NULL) cvm->handle.Array = lcvmGetClassHandle(cvm, "carrica", "Array");
-	wrenSetSlotHandle(vm, 1, cvm->handle.Array);
-	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 1, VM_REREF_SIZE);
+	wrenEnsureSlots(vm, 4);
+	wrenSetSlotHandle(vm, 3, cvm->handle.Array);
+	int cnt = (int)wrenGetSlotDouble(vm, 1);
+	luaPushFromWrenSlot(cvm, 2);
+	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 3, VM_REREF_SIZE);
 	ref->type = VM_WREN_SHARE_ARRAY;
 	ref->pref = avmLuaNewArray(wrenGetUserData(vm));
 	ref->cvm = cvm;
-	int cnt = (int)wrenGetSlotDouble(vm, 1);
 	lua_pushlightuserdata(cvm->L, ref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	luaPushFromWrenSlot(cvm, 2);
 	for (int i = 1; i <= cnt; i++) {
-		lua_pushvalue(cvm->L, -1);
+		lua_pushvalue(cvm->L, -2);
 		lua_rawseti(cvm->L, -2, i);
 	}
-	lua_pop(cvm->L, 1);
+	lua_pop(cvm->L, 2);
 }
 
 void avmFromList(WrenVM *vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
-	wrenEnsureSlots(vm, 3);
+	wrenEnsureSlots(vm, VM_LIST_CHUNK + 2);
 	if (cvm->handle.Array == NULL) cvm->handle.Array = lcvmGetClassHandle(cvm, "carrica", "Array");
 	wrenSetSlotHandle(vm, 2, cvm->handle.Array);
 	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 2, VM_REREF_SIZE);
 	ref->type = VM_WREN_SHARE_ARRAY;
 	ref->pref = avmLuaNewArray(cvm);
 	ref->cvm = cvm;
-	int pos = 0;
 	lua_pushlightuserdata(cvm->L, ref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	if (wrenGetSlotType(vm, 1) == WREN_TYPE_LIST) {
 		int cnt = wrenGetListCount(vm, 1);
-		int c = 0;
-		while (c < cnt) {
-			wrenGetListElement(vm, 1, c++, 2);
-			luaPushFromWrenSlot(cvm, 2);
-			lua_rawseti(cvm->L, -2, ++pos);
-		}
+		// swap in a table sized for the whole list
+		lua_pop(cvm->L, 1);
+		lua_pushlightuserdata(cvm->L, ref->pref);
+		lua_createtable(cvm->L, cnt, 0);
+		lua_pushvalue(cvm->L, -1);
+		lua_insert(cvm->L, -3);
+		lua_settable(cvm->L, LUA_REGISTRYINDEX);
+		avmFromWrenList(vm, cvm, 1, cnt, 0);
 	} else
 		wrenError(vm, "bad value passed to Array.fromList() list only");
 	lua_pop(cvm->L, 1);
@@ -127,215 +447,226 @@ void avmFromList(WrenVM *vm) {
 void avmAdd(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.add() can not be called on a view")
+	vmRefOwn(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	int pos = lua_objlen(cvm->L, -1) + 1;
 	luaPushFromWrenSlot(cvm, 1);
-	lua_rawseti(cvm->L, -1, lua_objlen(cvm->L, -1));
-	lua_pop(cvm->L, 1);	
+	if (reref->pref->indexed) {
+		int top = lua_gettop(cvm->L);
+		avmIndexWrite(reref->pref, cvm->L, top - 1, pos, top, 0);
+	}
+	lua_rawseti(cvm->L, -2, pos);
+	vmJournalIndex(reref->pref, VM_JOURNAL_SET, pos);
+	lua_pop(cvm->L, 1);
 }
 
 
 void avmAddAll(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.addAll() can not be called on a view")
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	int pos = lua_objlen(cvm->L, -1);
-	wrenEnsureSlots(vm, 3);
+	int start = pos;
 	if (wrenGetSlotType(vm, 1) == WREN_TYPE_LIST) {
-		int cnt = wrenGetListCount(vm, 1);
-		int c = 0;
-		while (c < cnt) {
-			wrenGetListElement(vm, 1, c++, 2);
-			luaPushFromWrenSlot(cvm, 2);
-			lua_rawseti(cvm->L, -2, ++pos);
-		}
+		avmFromWrenList(vm, cvm, 1, wrenGetListCount(vm, 1), pos);
 	} else if (wrenGetSlotType(vm, 1) == WREN_TYPE_FOREIGN) {
 		vmWrenReReference *other = wrenGetSlotForeign(vm, 1);
 		if (other->type != VM_WREN_SHARE_ARRAY) {
-			wrenError(vm, "bad value passed to Array.addAll() list or Array only");	
+			wrenError(vm, "bad value passed to Array.addAll() list or Array only");
 		} else {
-			lua_pushlightuserdata(cvm->L, other->pref);
-			lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-			int cnt = lua_objlen(cvm->L, -1);
+			int base;
+			int cnt = avmPushTable(cvm, other, &base);
 			for (int i = 0; i < cnt; i++) {
-				lua_rawgeti(cvm->L, -1, i + 1);
+				lua_rawgeti(cvm->L, -1, base + i + 1);
 				lua_rawseti(cvm->L, -3, ++pos);
 			}
 			lua_pop(cvm->L, 1);
 		}
 	} else
 		wrenError(vm, "bad value passed to Array.addAll() list or Array only");
+	avmJournalRange(reref->pref, start + 1, lua_objlen(cvm->L, -1) - start);
 	lua_pop(cvm->L, 1);
 }
 void avmPlus(WrenVM *vm) { avmAddAll(vm); }
 
-void avmIndexOf(WrenVM *vm) {
+// the body of Array.copy(), a whole Array that lua can't write to behind our
+// back is shared until one side writes, anything else is copied now
+void avmCopy(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	int end = lua_objlen(cvm->L, -1);
-	int pos = 0;
-	luaPushFromWrenSlot(cvm, 1);
-	while (pos < end) {
-		lua_rawgeti(cvm->L, -2, pos + 1);
-		if (lua_equal(cvm->L, -1, -2)) {
-			lua_pop(cvm->L, 2);
-			wrenSetSlotDouble(vm, 0, pos);
-		} else {
-			lua_pop(cvm->L, 1);
-			pos++;
+	if (wrenGetSlotType(vm, 1) == WREN_TYPE_FOREIGN) {
+		vmWrenReReference *other = wrenGetSlotForeign(vm, 1);
+		if ((other->type == VM_WREN_SHARE_ARRAY) && !other->view && !other->pref->exposed
+			&& (other->cvm == reref->cvm)) {
+			avmIndexDrop(reref->pref);
+			vmRefShare(reref->pref, other->pref);
+			return;
 		}
 	}
-	lua_pop(cvm->L, 2);
-	wrenSetSlotDouble(vm, 0, -1);
+	avmAddAll(vm);
+}
+
+// the position (from 0) of the first element the same as the value in slot
+// within the len elements after base, or -1, for the table on top of the stack,
+// the index is built for this when build is set and otherwise only used if it
+// is already there
+static int avmFind(carricaVM *cvm, vmWrenReReference *reref, int slot, int base, int len, bool build) {
+	lua_State *L = cvm->L;
+	int t = lua_gettop(L);
+	int from = base + 1;
+	luaPushFromWrenSlot(cvm, slot);
+	if ((lua_objlen(L, t) >= AVM_INDEX_MIN) && (build || avmIndexValid(reref->pref))) {
+		avmIndexPush(reref->pref, L, t);
+		lua_pushvalue(L, -2);
+		lua_rawget(L, -2);
+		int first = lua_tointeger(L, -1);
+		lua_pop(L, 2);
+		if ((first == 0) || (first > base + len)) {
+			lua_pop(L, 1);
+			return -1;
+		}
+		if (first >= from) {
+			lua_pop(L, 1);
+			return first - from;
+		}
+		// a view starting past the first one still has to look
+	}
+	for (int i = from; i <= base + len; i++) {
+		lua_rawgeti(L, t, i);
+		bool same = lua_rawequal(L, -1, -2);
+		lua_pop(L, 1);
+		if (same) {
+			lua_pop(L, 1);
+			return i - from;
+		}
+	}
+	lua_pop(L, 1);
+	return -1;
+}
+
+void avmIndexOf(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
+	wrenSetSlotDouble(vm, 0, avmFind(cvm, reref, 1, base, len, true));
+	lua_pop(cvm->L, 1);
+}
+
+void avmContains(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
+	wrenSetSlotBool(vm, 0, avmFind(cvm, reref, 1, base, len, true) >= 0);
+	lua_pop(cvm->L, 1);
 }
 
 void avmInsert(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.insert() can not be called on a view")
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	int end = lua_objlen(cvm->L, -1);
 	int pos = (int)wrenGetSlotDouble(vm, 1);
-	if (pos < 0) {
-		pos = end + pos;
-		if (pos < 0) {
-			lua_pop(cvm->L, 1);
-			wrenError(vm, "index out of bounds on Array.insert()");
-			return;
-		}
-	}
-	if (pos >= end) {
-		lua_pop(cvm->L, 1);
-		wrenError(vm, "index out of bounds on Array.insert()");
-		return;
-	}
-	if (pos + 1 == end) {
-		// adding to the end, easey peasey
-		luaPushFromWrenSlot(cvm, 2);
-		lua_rawseti(cvm->L, -2, pos + 1);
-	} else {
-		// ok we need to move stuff down first
-		int mp = pos + 1;
-		while (mp < end) {
-			lua_rawgeti(cvm->L, -1, mp++);
-			lua_rawseti(cvm->L, -1, mp);
-		}
-		luaPushFromWrenSlot(cvm, 2);
-		lua_rawseti(cvm->L, -2, pos + 1);
+	// like List.insert(), a negative index counts back from one past the end
+	if (pos < 0) pos = end + pos + 1;
+	if ((pos < 0) || (pos > end))
+		AERR("index out of bounds on Array.insert()")
+	// move everything from pos down one, then drop the item in
+	for (int mp = end; mp > pos; mp--) {
+		lua_rawgeti(cvm->L, -1, mp);
+		lua_rawseti(cvm->L, -2, mp + 1);
 	}
+	luaPushFromWrenSlot(cvm, 2);
+	lua_rawseti(cvm->L, -2, pos + 1);
+	vmJournalIndex(reref->pref, VM_JOURNAL_INSERT, pos + 1);
 	lua_pop(cvm->L, 1);
 }
 
+// remove the element at pos (from 0) of the table on the top of the stack,
+// leaving the removed value pushed above it
+static void avmRemoveIndex(lua_State *L, int pos, int end) {
+	lua_rawgeti(L, -1, pos + 1);
+	for (int mp = pos + 1; mp < end; mp++) {
+		lua_rawgeti(L, -2, mp + 1);
+		lua_rawseti(L, -3, mp);
+	}
+	lua_pushnil(L);
+	lua_rawseti(L, -3, end);
+}
+
 void avmRemove(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.remove() can not be called on a view")
+	vmRefOwn(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	int end = lua_objlen(cvm->L, -1);
-	int pos = 0;
-	luaPushFromWrenSlot(cvm, 1);
-	while (pos < end) {
-		lua_rawgeti(cvm->L, -2, pos + 1);
-		if (lua_equal(cvm->L, -1, -2)) {
-			lua_pop(cvm->L, 2);
-			// found the index, as now remove it
-			// just move everything up one
-			pos++;
-			while (pos < end) {
-				lua_rawgeti(cvm->L, -2, pos + 1);
-				lua_rawseti(cvm->L, -2, pos);
-			}
-			// and remove the last element
-			lua_pushnil(cvm->L);
-			lua_rawseti(cvm->L, -2, pos);
-		} else {
-			lua_pop(cvm->L, 1);
-			pos++;
-		}
+	// one remove() is a scan either way, so it's not worth building the index
+	int pos = avmFind(cvm, reref, 1, 0, end, false);
+	if (pos < 0) {
+		lua_pop(cvm->L, 1);
+		wrenSetSlotNull(vm, 0);
+		return;
 	}
+	// found the index, now remove it and hand back the value
+	avmRemoveIndex(cvm->L, pos, end);
+	avmIndexRemove(reref->pref, cvm->L, lua_gettop(cvm->L) - 1, pos + 1, lua_gettop(cvm->L), end - 1);
+	vmJournalIndex(reref->pref, VM_JOURNAL_REMOVE, pos + 1);
+	wrenSetSlotFromLua(cvm, 0, -1);
 	lua_pop(cvm->L, 2);
 }
 
 void avmRemoveAt(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	if (reref->view) WERR("Array.removeAt() can not be called on a view")
+	vmRefOwn(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	int end = lua_objlen(cvm->L, -1);
 	int pos = (int)wrenGetSlotDouble(vm, 1);
-	if (pos < 0) {
-		pos = end + pos;
-		if (pos < 0) {
-			lua_pop(cvm->L, 1);
-			wrenError(vm, "index out of bounds on Array.removeAt()");
-			return;
-		}
-	}
-	if (pos >= end) {
-		lua_pop(cvm->L, 1);
-		wrenError(vm, "index out of bounds on Array.removeAt()");
-		return;
-	}
-	if (pos + 1 == end) {
-		// removing the end, so really easy
-		lua_pushnil(cvm->L);
-		lua_rawseti(cvm->L, -2, pos + 1);
-	} else {
-		// found the index, as now remove it
-		// just move everything up one
-		pos++;
-		while (pos < end) {
-			lua_rawgeti(cvm->L, -2, pos + 1);
-			lua_rawseti(cvm->L, -2, pos);
-		}
-		// and remove the last element
-		lua_pushnil(cvm->L);
-		lua_rawseti(cvm->L, -2, pos);	
-	}
-	lua_pop(cvm->L, 1);
+	if (pos < 0) pos = end + pos;
+	if ((pos < 0) || (pos >= end))
+		AERR("index out of bounds on Array.removeAt()")
+	avmRemoveIndex(cvm->L, pos, end);
+	avmIndexRemove(reref->pref, cvm->L, lua_gettop(cvm->L) - 1, pos + 1, lua_gettop(cvm->L), end - 1);
+	vmJournalIndex(reref->pref, VM_JOURNAL_REMOVE, pos + 1);
+	wrenSetSlotFromLua(cvm, 0, -1);
+	lua_pop(cvm->L, 2);
 }
 
 void avmSwap(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	int end = lua_objlen(cvm->L, -1);
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
+	int base;
+	int end = avmPushTable(cvm, reref, &base);
 	int a = (int)wrenGetSlotDouble(vm, 1);
 	int b = (int)wrenGetSlotDouble(vm, 2);
-	if (a < 0) {
-		a = end + a;
-		if (a < 0) {
-			lua_pop(cvm->L, 1);
-			wrenError(vm, "index a out of bounds on Array.swap()");
-			return;
-		}
-	}
-	if (b < 0) {
-		b = end + b;
-		if (b < 0) {
-			lua_pop(cvm->L, 1);
-			wrenError(vm, "index b out of bounds on Array.swap()");
-			return;
-		}
-	}
-	if (a >= end) {
-		lua_pop(cvm->L, 1);
-		wrenError(vm, "index a out of bounds on Array.swap()");
-		return;
-	}
-	if (b >= end) {
-		lua_pop(cvm->L, 1);
-		wrenError(vm, "index b out of bounds on Array.swap()");
-		return;
-	}
-	lua_rawgeti(cvm->L, -1, a + 1);
-	lua_rawgeti(cvm->L, -2, b + 1);
-	lua_rawseti(cvm->L, -3, a + 1);
-	lua_rawseti(cvm->L, -2, b + 1);
+	if (a < 0) a = end + a;
+	if (b < 0) b = end + b;
+	if ((a < 0) || (a >= end))
+		AERR("index a out of bounds on Array.swap()")
+	if ((b < 0) || (b >= end))
+		AERR("index b out of bounds on Array.swap()")
+	lua_rawgeti(cvm->L, -1, base + a + 1);
+	lua_rawgeti(cvm->L, -2, base + b + 1);
+	lua_rawseti(cvm->L, -3, base + a + 1);
+	lua_rawseti(cvm->L, -2, base + b + 1);
+	vmJournalIndex(reref->pref, VM_JOURNAL_SET, base + a + 1);
+	vmJournalIndex(reref->pref, VM_JOURNAL_SET, base + b + 1);
 	lua_pop(cvm->L, 1);
 }
 
@@ -350,13 +681,175 @@ void avmRelease(WrenVM *vm) {
 	if (reref->pref->refCount > 0) reref->pref->refCount--;
 }
 
+typedef struct _avmSortString {
+	const char *str;
+	size_t len;
+	int idx;
+} avmSortString;
+
+static int avmCompareNumber(const void *a, const void *b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// byte order, which is what lua's < gives for strings under the C locale
+static int avmCompareString(const void *a, const void *b) {
+	const avmSortString *x = a;
+	const avmSortString *y = b;
+	int r = memcmp(x->str, y->str, x->len < y->len ? x->len : y->len);
+	if (r) return r;
+	return (x->len > y->len) - (x->len < y->len);
+}
+
+// true when strcoll() is plain byte order, under any other LC_COLLATE lua's <
+// may not agree with memcmp() (PUC lua collates, LuaJIT doesn't), so strings
+// are left to the lua sort function
+static bool avmCollateIsBytes() {
+	const char *name = setlocale(LC_COLLATE, NULL);
+	return (name == NULL) || !strcmp(name, "C") || !strcmp(name, "POSIX");
+}
+
+// sort len elements after base of the table at stack index t in C if they are
+// only numbers or only strings, returns false (touching nothing) otherwise
+static bool avmSortFast(lua_State *L, int t, int base, int len) {
+	int type = LUA_TNONE;
+	for (int i = 1; i <= len; i++) {
+		lua_rawgeti(L, t, base + i);
+		int et = lua_type(L, -1);
+		lua_pop(L, 1);
+		if (type == LUA_TNONE) type = et;
+		if ((et != type) || ((et != LUA_TNUMBER) && (et != LUA_TSTRING))) return false;
+	}
+	if ((type == LUA_TSTRING) && !avmCollateIsBytes()) return false;
+	if (len < 2) return true;
+	if (type == LUA_TNUMBER) {
+		double *num = malloc(sizeof(double) * len);
+		if (num == NULL) return false;
+		for (int i = 0; i < len; i++) {
+			lua_rawgeti(L, t, base + i + 1);
+			num[i] = lua_tonumber(L, -1);
+			lua_pop(L, 1);
+		}
+		qsort(num, len, sizeof(double), avmCompareNumber);
+		for (int i = 0; i < len; i++) {
+			lua_pushnumber(L, num[i]);
+			lua_rawseti(L, t, base + i + 1);
+		}
+		free(num);
+	} else {
+		avmSortString *str = malloc(sizeof(avmSortString) * len);
+		if (str == NULL) return false;
+		// a copy of the table keeps the strings alive while we write over t
+		lua_createtable(L, len, 0);
+		for (int i = 1; i <= len; i++) {
+			lua_rawgeti(L, t, base + i);
+			str[i - 1].str = lua_tolstring(L, -1, &str[i - 1].len);
+			str[i - 1].idx = i;
+			lua_rawseti(L, -2, i);
+		}
+		qsort(str, len, sizeof(avmSortString), avmCompareString);
+		for (int i = 0; i < len; i++) {
+			lua_rawgeti(L, -1, str[i].idx);
+			lua_rawseti(L, t, base + i + 1);
+		}
+		lua_pop(L, 1);
+		free(str);
+	}
+	return true;
+}
+
 void avmSort(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
+	int t = lua_gettop(cvm->L);
+	avmJournalRange(reref->pref, base + 1, len);
+	// plain numbers or strings never need to leave C, unless lua asked for
+	// its own sort function with carrica.setSortFunc()
+	if (lua_hasDefaultSortFunction() && avmSortFast(cvm->L, t, base, len)) {
+		lua_pop(cvm->L, 1);
+		return;
+	}
+	if (!reref->view) {
+		lua_pushSortFunction(cvm->L);
+		lua_insert(cvm->L, -2);
+		vmLuaCall(cvm, 1, 0);
+		return;
+	}
+	// the lua sort function wants a whole table, so sort a copy of the view
 	lua_pushSortFunction(cvm->L);
+	lua_createtable(cvm->L, len, 0);
+	for (int i = 1; i <= len; i++) {
+		lua_rawgeti(cvm->L, t, base + i);
+		lua_rawseti(cvm->L, -2, i);
+	}
+	lua_pushvalue(cvm->L, -1);
+	lua_insert(cvm->L, -3);
+	vmLuaCall(cvm, 1, 0);
+	for (int i = 1; i <= len; i++) {
+		lua_rawgeti(cvm->L, -1, i);
+		lua_rawseti(cvm->L, t, base + i);
+	}
+	lua_pop(cvm->L, 2);
+}
+
+// fill a Wren list with up to it's count of elements from index start,
+// returning how many were written, this is how Wren side loops walk us
+void avmChunk(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("bad parameters passed to Array.chunk_(), list and number expected")
+	int start = (int)wrenGetSlotDouble(vm, 2);
+	int size = wrenGetListCount(vm, 1);
+	int base;
+	int n = avmPushTable(cvm, reref, &base) - start;
+	if (n > size) n = size;
+	if (n < 0) n = 0;
+	avmToWrenList(vm, cvm, 1, 0, base + start, n);
+	lua_pop(cvm->L, 1);
+	wrenSetSlotDouble(vm, 0, n);
+}
+
+// append the first count elements of a Wren list
+void avmAddChunk(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("bad parameters passed to Array.addChunk_(), list and number expected")
+	if (reref->view) WERR("Array.addChunk_() can not be called on a view")
+	int cnt = (int)wrenGetSlotDouble(vm, 2);
+	if (cnt > wrenGetListCount(vm, 1)) cnt = wrenGetListCount(vm, 1);
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_call(cvm->L, 1, 0);
+	int pos = lua_objlen(cvm->L, -1);
+	avmFromWrenList(vm, cvm, 1, cnt, pos);
+	avmJournalRange(reref->pref, pos + 1, cnt);
+	lua_pop(cvm->L, 1);
+}
+
+// overwrite our elements in place from a Wren list, so lua still sees the same table
+void avmSetAll(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST)
+		WERR("bad parameter passed to Array.setAll_(), list expected")
+	int cnt = wrenGetListCount(vm, 1);
+	vmRefOwn(reref->pref);
+	avmIndexDrop(reref->pref);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
+	// a view can't grow, so stay inside it
+	if (reref->view && (cnt > len)) cnt = len;
+	avmFromWrenList(vm, cvm, 1, cnt, base);
+	avmJournalRange(reref->pref, base + 1, cnt);
+	lua_pop(cvm->L, 1);
 }
 
 void avmTimes(WrenVM *vm) {
@@ -367,22 +860,33 @@ void avmTimes(WrenVM *vm) {
 		wrenError(vm, "array.*() called with a bad integer value");
 		return;
 	}
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	vmWrenReference *pref = reref->pref;
+	bool share = (cnt == 1) && !reref->view && !pref->exposed;
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
 	if (cvm->handle.Array == NULL) cvm->handle.Array = lcvmGetClassHandle(cvm, "carrica", "Array");
 	wrenSetSlotHandle(vm, 1, cvm->handle.Array);
 	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 1, VM_REREF_SIZE);
 	ref->type = VM_WREN_SHARE_ARRAY;
 	ref->pref = avmLuaNewArray(cvm);
 	ref->cvm = cvm;
+	if (share) {
+		// a single copy is just a clone
+		vmRefShare(ref->pref, pref);
+		lua_pop(cvm->L, 1);
+		return;
+	}
+	// swap in a table sized for the whole result
 	lua_pushlightuserdata(cvm->L, ref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	lua_createtable(cvm->L, len * cnt, 0);
+	lua_pushvalue(cvm->L, -1);
+	lua_insert(cvm->L, -3);
+	lua_settable(cvm->L, LUA_REGISTRYINDEX);
 	// ok now we just fill the new table 'cnt' times
-	int len = lua_objlen(cvm->L, -2);
 	int pos = 1;
 	while (cnt-- > 0) {
 		for (int i = 0; i < len; i++) {
-			lua_rawgeti(cvm->L, -2, i + 1);
+			lua_rawgeti(cvm->L, -2, base + i + 1);
 			lua_rawseti(cvm->L, -2, pos++);
 		}
 	}
@@ -392,17 +896,12 @@ void avmTimes(WrenVM *vm) {
 void avmList(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	int len = lua_objlen(cvm->L, -1);
-	wrenEnsureSlots(vm, 2);
+	int base;
+	int len = avmPushTable(cvm, reref, &base);
 	wrenSetSlotNewList(vm, 0);
-	for (int i = 0; i < len; i++) {
-		lua_rawgeti(cvm->L, -1, i + 1);
-		wrenSetSlotFromLua(cvm, 1, -1);
-		wrenInsertInList(vm, 0, -1, 1);
-		lua_pop(cvm->L, 1);
-	}
+	wrenReserveList(vm, 0, len);
+	avmToWrenList(vm, cvm, 0, 0, base, len);
+	lua_pop(cvm->L, 1);
 }
 
 // create and return a new Table
@@ -417,38 +916,12 @@ void avmAllocate(WrenVM* vm) {
 void avmFinalize(void *obj) {
 	vmWrenReReference* ref = obj;
 	if (ref->pref->refCount > 0) ref->pref->refCount--;
-	// let lua handle cleanup in garbage collection
-}
-
-void avmIterate(WrenVM *vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	int i = 0;
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) {
-		wrenSetSlotDouble(vm, 0, 0);
-		return;
-	} else {
-		i = (int)wrenGetSlotDouble(vm, 1);
-		carricaVM *cvm = wrenGetUserData(vm);
-		lua_pushlightuserdata(cvm->L, reref->pref);
-		lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-		if (i >= lua_objlen(cvm->L, -1)) {
-			wrenSetSlotBool(vm, 0, false);
-			lua_pop(cvm->L, 1);
-		} else {
-			wrenSetSlotDouble(vm, 0, (double)++i);
-		}
-		lua_pop(cvm->L, 1);
+	// lua never sees the reference of a Wren made Array, so it's share can go now
+	if ((ref->pref->refCount == 0) && (ref->pref->handle == NULL)) {
+		vmRefDrop(ref->pref);
+		avmIndexDrop(ref->pref);
 	}
-}
-
-void avmIteratorValue(WrenVM *vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, (int)wrenGetSlotDouble(vm, 1) + 1);
-	wrenSetSlotFromLua(cvm, 0, -1);
-	lua_pop(cvm->L, 2);
+	// let lua handle cleanup in garbage collection
 }
 
 // ********************************************************************************
@@ -461,20 +934,25 @@ const vmForeignMethodDef _a_func[] = {
 	{ true, "fromList(_)", avmFromList },
 	{ false, "add(_)", avmAdd },
 	{ false, "addAll(_)", avmAddAll },
+	{ false, "copy_(_)", avmCopy },
 	{ false, "clear()", avmClear },
 	{ false, "count", avmCount },
 	{ false, "indexOf(_)", avmIndexOf },
+	{ false, "contains(_)", avmContains },
 	{ false, "insert(_,_)", avmInsert },
 	{ false, "remove(_)", avmRemove },
 	{ false, "removeAt(_)", avmRemoveAt },
 	{ false, "sort()", avmSort },
+	{ false, "chunk_(_,_)", avmChunk },
+	{ false, "addChunk_(_,_)", avmAddChunk },
+	{ false, "setAll_(_)", avmSetAll },
 	{ false, "swap(_,_)", avmSwap },
+	{ false, "view(_,_)", avmView },
+	{ false, "isView", avmIsView },
 	{ false, "+(_)", avmPlus },
 	{ false, "*(_)", avmTimes },
 	{ false, "hold()", avmHold },
 	{ false, "release()", avmRelease },
-	{ false, "iterate(_)", avmIterate },
-	{ false, "iteratorValue(_)", avmIteratorValue },
 	{ false, "list", avmList },
 	{ false, NULL, NULL }
 };
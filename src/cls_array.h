@@ -10,5 +10,8 @@
 
 #include "vm.h"
 vmWrenReference* avmLuaNewArray(carricaVM *cvm);
+int avmPushTable(carricaVM *cvm, vmWrenReReference *reref, int *base);
+void avmLuaPushView(carricaVM *cvm, vmWrenReReference *reref);
+void avmLuaReplace(carricaVM *cvm, vmWrenReference *ref, int first, int n);
 extern const vmForeignModule vmiArray;
 
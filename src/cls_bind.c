@@ -0,0 +1,337 @@
+/*
+	cls_bind.c
+
+	wren running under lua 5.1+
+	implementation of classes bound from lua with vm:bindClass() and
+	vm:defineLuaClass()
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "cls_bind.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a VM can't bind more lua functions (or methods) than we have trampolines for
+#define BVM_MAX_BINDINGS	256
+// each function is declared for every arity up to Wren's own limit, a lua class
+// constructor loses one to the module index
+#define BVM_MAX_ARGS		16
+
+// names a function can't have, Wren keywords
+static const char *bvmReserved[] = {
+	"as", "break", "class", "construct", "continue", "else", "false", "for", "foreign",
+	"if", "import", "in", "is", "null", "return", "static", "super", "this", "true",
+	"var", "while", NULL
+};
+
+// ********************************************************************************
+// the trampolines, one per binding so a call goes straight to it's lua function
+// with nothing to look up but the registry slot it was given
+
+static void bvmCall(WrenVM *vm, int n) {
+	carricaVM *cvm = wrenGetUserData(vm);
+	lua_State *L = cvm->L;
+	vmBinding *b = &cvm->bind->entry[n];
+	// a method passes the receiver along too, as self
+	int first = b->method ? 0 : 1;
+	int args = wrenGetSlotCount(vm) - first;
+	lua_checkstack(L, args + 1);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, b->ref);
+	for (int i = 0; i < args; i++) luaPushFromWrenSlot(cvm, first + i);
+	vmLuaCall(cvm, args, 1);
+	// marshal the return into a wren form
+	wrenSetSlotFromLua(cvm, 0, -1);
+	lua_pop(L, 1);
+}
+
+#define BVM_CALL(a, b) \
+static void bvmCall##a##_##b(WrenVM *vm) { bvmCall(vm, a * 8 + b); }
+#define BVM_CALL8(a) \
+	BVM_CALL(a, 0) BVM_CALL(a, 1) BVM_CALL(a, 2) BVM_CALL(a, 3) \
+	BVM_CALL(a, 4) BVM_CALL(a, 5) BVM_CALL(a, 6) BVM_CALL(a, 7)
+
+BVM_CALL8(0) BVM_CALL8(1) BVM_CALL8(2) BVM_CALL8(3)
+BVM_CALL8(4) BVM_CALL8(5) BVM_CALL8(6) BVM_CALL8(7)
+BVM_CALL8(8) BVM_CALL8(9) BVM_CALL8(10) BVM_CALL8(11)
+BVM_CALL8(12) BVM_CALL8(13) BVM_CALL8(14) BVM_CALL8(15)
+BVM_CALL8(16) BVM_CALL8(17) BVM_CALL8(18) BVM_CALL8(19)
+BVM_CALL8(20) BVM_CALL8(21) BVM_CALL8(22) BVM_CALL8(23)
+BVM_CALL8(24) BVM_CALL8(25) BVM_CALL8(26) BVM_CALL8(27)
+BVM_CALL8(28) BVM_CALL8(29) BVM_CALL8(30) BVM_CALL8(31)
+
+#define BVM_ENTRY8(a) bvmCall##a##_0, bvmCall##a##_1, bvmCall##a##_2, bvmCall##a##_3, \
+	bvmCall##a##_4, bvmCall##a##_5, bvmCall##a##_6, bvmCall##a##_7
+
+static const WrenForeignMethodFn bvmCalls[BVM_MAX_BINDINGS] = {
+	BVM_ENTRY8(0), BVM_ENTRY8(1), BVM_ENTRY8(2), BVM_ENTRY8(3),
+	BVM_ENTRY8(4), BVM_ENTRY8(5), BVM_ENTRY8(6), BVM_ENTRY8(7),
+	BVM_ENTRY8(8), BVM_ENTRY8(9), BVM_ENTRY8(10), BVM_ENTRY8(11),
+	BVM_ENTRY8(12), BVM_ENTRY8(13), BVM_ENTRY8(14), BVM_ENTRY8(15),
+	BVM_ENTRY8(16), BVM_ENTRY8(17), BVM_ENTRY8(18), BVM_ENTRY8(19),
+	BVM_ENTRY8(20), BVM_ENTRY8(21), BVM_ENTRY8(22), BVM_ENTRY8(23),
+	BVM_ENTRY8(24), BVM_ENTRY8(25), BVM_ENTRY8(26), BVM_ENTRY8(27),
+	BVM_ENTRY8(28), BVM_ENTRY8(29), BVM_ENTRY8(30), BVM_ENTRY8(31) };
+
+// ********************************************************************************
+// lua class instances, the lua object lives in the registry keyed by a
+// vmWrenReference that the Wren object counts a reference on
+
+// new_(index, ...) makes the object an empty table and hands it to the class's
+// new function as self, along with the arguments, if new returns something
+// that is the object instead
+static void bvmAllocate(WrenVM *vm) {
+	carricaVM *cvm = wrenGetUserData(vm);
+	lua_State *L = cvm->L;
+	vmBindModule *m = &cvm->bind->module[(int)wrenGetSlotDouble(vm, 1)];
+	int args = wrenGetSlotCount(vm) - 2;
+	vmWrenReference *pref = calloc(1, VM_REF_SIZE);
+	pref->type = VM_WREN_SHARE_LSOBJ;
+	pref->refCount = 1;
+	pref->cvm = cvm;
+	lua_checkstack(L, args + 4);
+	lua_pushlightuserdata(L, pref);
+	lua_newtable(L);
+	if (m->create != LUA_NOREF) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, m->create);
+		lua_pushvalue(L, -2);
+		for (int i = 0; i < args; i++) luaPushFromWrenSlot(cvm, i + 2);
+		vmLuaCall(cvm, args + 1, 1);
+		if (lua_isnil(L, -1)) lua_pop(L, 1); else lua_replace(L, -2);
+	}
+	lua_settable(L, LUA_REGISTRYINDEX);
+	vmWrenReReference *ref = wrenSetSlotNewForeign(vm, 0, 0, VM_REREF_SIZE);
+	ref->type = VM_WREN_SHARE_LSOBJ;
+	ref->cvm = cvm;
+	ref->pref = pref;
+	ref->view = false;
+}
+
+// the object goes from the registry with the last reference, lua collects it
+// once it lets go as well
+static void bvmFinalize(void *obj) {
+	vmWrenReReference *ref = obj;
+	vmWrenReference *pref = ref->pref;
+	if (--pref->refCount > 0) return;
+	lua_pushlightuserdata(ref->cvm->L, pref);
+	lua_pushnil(ref->cvm->L);
+	lua_settable(ref->cvm->L, LUA_REGISTRYINDEX);
+	free(pref);
+}
+
+// ********************************************************************************
+// binding, every module we made comes through here
+
+static WrenForeignMethodFn bvmBindMethod(WrenVM* vm, const char* module,
+						const char* className, bool isStatic, const char* signature) {
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (cvm->bind == NULL) return NULL;
+	size_t n = strcspn(signature, "(");
+	for (int i = 0; i < cvm->bind->count; i++) {
+		vmBinding *b = &cvm->bind->entry[i];
+		if ((b->method != isStatic) && !strcmp(b->module, module) && (strlen(b->name) == n)
+				&& !strncmp(b->name, signature, n))
+			return bvmCalls[i];
+	}
+	return NULL;
+}
+
+static WrenForeignClassMethods bvmBindClass(WrenVM* vm, const char* module, const char* className) {
+	WrenForeignClassMethods ret = { NULL, NULL };
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (cvm->bind == NULL) return ret;
+	for (int i = 0; i < cvm->bind->modules; i++) {
+		if (cvm->bind->module[i].luaClass && !strcmp(cvm->bind->module[i].def.name, module)) {
+			ret.allocate = bvmAllocate;
+			ret.finalize = bvmFinalize;
+		}
+	}
+	return ret;
+}
+
+// ********************************************************************************
+// binding a class from lua
+
+static bool bvmIsName(const char *s) {
+	if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))) return false;
+	for (s++; *s; s++)
+		if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9') || (*s == '_')))
+			return false;
+	return true;
+}
+
+static bool bvmIsReserved(const char *s) {
+	for (int i = 0; bvmReserved[i]; i++)
+		if (!strcmp(bvmReserved[i], s)) return true;
+	return false;
+}
+
+static bool bvmModuleExists(carricaVM *cvm, const char *module) {
+	if (vmHasModule(cvm, module)) return true;
+	for (int i = 0; i < cvm->modtable.count; i++)
+		if (cvm->modtable.mod[i].def.name && !strcmp(cvm->modtable.mod[i].def.name, module)) return true;
+	return false;
+}
+
+// the parameter list for arity a, after any leading text
+static int bvmParams(char *dst, size_t max, const char *lead, int a) {
+	int len = snprintf(dst, max, "%s", lead);
+	for (int i = 0; i < a; i++)
+		len += snprintf(dst + len, max - len, (i || *lead) ? ", a%d" : "a%d", i);
+	return len;
+}
+
+// room for a function declared at every arity
+static size_t bvmSourceSize(lua_State *L, int idx) {
+	size_t max = 256;
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		max += (strlen(lua_tostring(L, -2)) + 48) * (BVM_MAX_ARGS + 1) + 3 * BVM_MAX_ARGS * BVM_MAX_ARGS;
+		lua_pop(L, 1);
+	}
+	return max;
+}
+
+// the Wren module, a class with a foreign method per function for each arity,
+// so Wren can pass whatever lua wants, a lua class gets a constructor for each
+// arity too which passes id (the module index) to the allocator
+static char* bvmMakeSource(lua_State *L, const char *className, int idx, bool luaClass, int id) {
+	size_t max = bvmSourceSize(L, idx) + (luaClass ? 64 * BVM_MAX_ARGS + 16 * BVM_MAX_ARGS * BVM_MAX_ARGS : 0);
+	char *src = malloc(max);
+	char lead[16];
+	snprintf(lead, 16, "%d", id);
+	int len;
+	if (luaClass) {
+		len = snprintf(src, max, "// made by vm:defineLuaClass()\nforeign class %s {\n", className);
+		for (int a = 0; a < BVM_MAX_ARGS; a++) {
+			len += snprintf(src + len, max - len, "\tconstruct new_(");
+			len += bvmParams(src + len, max - len, "c", a);
+			len += snprintf(src + len, max - len, ") { }\n\tstatic new(");
+			len += bvmParams(src + len, max - len, "", a);
+			len += snprintf(src + len, max - len, ") { new_(");
+			len += bvmParams(src + len, max - len, lead, a);
+			len += snprintf(src + len, max - len, ") }\n");
+		}
+	} else
+		len = snprintf(src, max, "// made by vm:bindClass()\nclass %s {\n", className);
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		const char *name = lua_tostring(L, -2);
+		if (!luaClass || strcmp(name, "new")) {
+			for (int a = 0; a <= BVM_MAX_ARGS; a++) {
+				len += snprintf(src + len, max - len, luaClass ? "\tforeign %s(" : "\tforeign static %s(", name);
+				len += bvmParams(src + len, max - len, "", a);
+				len += snprintf(src + len, max - len, ")\n");
+			}
+		}
+		lua_pop(L, 1);
+	}
+	snprintf(src + len, max - len, "}\n");
+	return src;
+}
+
+// check the table of functions at idx, before we keep anything of it
+static int bvmCheck(lua_State *L, carricaVM *cvm, const char *fname, const char *module,
+						const char *className, int idx, bool luaClass) {
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", fname);
+	if (!bvmIsName(className) || bvmIsReserved(className))
+		luaL_error(L, "carrica -> %s class name must be an identifier", fname);
+	if (bvmModuleExists(cvm, module))
+		luaL_error(L, "carrica -> %s module '%s' already exists", fname, module);
+	int count = 0;
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		const char *name = (lua_type(L, -2) == LUA_TSTRING) ? lua_tostring(L, -2) : NULL;
+		if ((name == NULL) || !bvmIsName(name) || bvmIsReserved(name) || (name[strlen(name) - 1] == '_'))
+			luaL_error(L, "carrica -> %s function names must be identifiers", fname);
+		if (lua_type(L, -1) != LUA_TFUNCTION)
+			luaL_error(L, "carrica -> %s '%s' is not a function", fname, name);
+		if (!luaClass || strcmp(name, "new")) count++;
+		lua_pop(L, 1);
+	}
+	if (cvm->bind == NULL) {
+		cvm->bind = calloc(1, sizeof(vmBindings));
+		cvm->bind->entry = calloc(BVM_MAX_BINDINGS, sizeof(vmBinding));
+	}
+	if (cvm->bind->count + count > BVM_MAX_BINDINGS)
+		luaL_error(L, "carrica -> %s can bind at most %d functions to a VM", fname, BVM_MAX_BINDINGS);
+	return count;
+}
+
+// make the module and bind the functions of the table at idx to trampolines
+static void bvmInstall(lua_State *L, carricaVM *cvm, const char *module, const char *className,
+						int idx, bool luaClass) {
+	vmBindings *bind = cvm->bind;
+	int id = bind->modules;
+	bind->module = realloc(bind->module, sizeof(vmBindModule) * (bind->modules + 1));
+	vmBindModule *m = &bind->module[bind->modules++];
+	m->def.name = strdup(module);
+	m->def.source = bvmMakeSource(L, className, idx, luaClass, id);
+	m->luaClass = luaClass;
+	m->create = LUA_NOREF;
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		if (luaClass && !strcmp(lua_tostring(L, -2), "new")) {
+			m->create = luaL_ref(L, LUA_REGISTRYINDEX);
+			continue;
+		}
+		vmBinding *b = &bind->entry[bind->count++];
+		b->module = m->def.name;
+		b->name = strdup(lua_tostring(L, -2));
+		b->method = luaClass;
+		// takes the function off the stack
+		b->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	carricaModule mod;
+	mod.def.name = m->def.name;
+	mod.def.source = m->def.source;
+	mod.bindForeignMethod = bvmBindMethod;
+	mod.bindForeignClass = bvmBindClass;
+	vmInstallBinaryMod(cvm, &mod);
+}
+
+// vm:bindClass(module, className, { name = function, ... }), afterwards Wren can
+// import className from module and call className.name(...) to call the function
+int bvmLuaBindClass(lua_State *L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	const char *module = luaL_checkstring(L, 2);
+	const char *className = luaL_checkstring(L, 3);
+	luaL_checktype(L, 4, LUA_TTABLE);
+	bvmCheck(L, cvm, ".bindClass()", module, className, 4, false);
+	bvmInstall(L, cvm, module, className, 4, false);
+	return 0;
+}
+
+// vm:defineLuaClass(module, className, { new = function, name = function, ... }),
+// className.new(...) in Wren makes an instance with a lua object behind it and
+// instance.name(...) calls the function with that object as self
+int bvmLuaDefineClass(lua_State *L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	const char *module = luaL_checkstring(L, 2);
+	const char *className = luaL_checkstring(L, 3);
+	luaL_checktype(L, 4, LUA_TTABLE);
+	bvmCheck(L, cvm, ".defineLuaClass()", module, className, 4, true);
+	bvmInstall(L, cvm, module, className, 4, true);
+	return 0;
+}
+
+// let go of the functions and sources, when the VM goes
+void bvmRelease(carricaVM *cvm) {
+	vmBindings *bind = cvm->bind;
+	if (bind == NULL) return;
+	for (int i = 0; i < bind->count; i++) {
+		luaL_unref(cvm->L, LUA_REGISTRYINDEX, bind->entry[i].ref);
+		free(bind->entry[i].name);
+	}
+	for (int i = 0; i < bind->modules; i++) {
+		luaL_unref(cvm->L, LUA_REGISTRYINDEX, bind->module[i].create);
+		free((char*)bind->module[i].def.name);
+		free((char*)bind->module[i].def.source);
+	}
+	free(bind->module);
+	free(bind->entry);
+	free(bind);
+	cvm->bind = NULL;
+}
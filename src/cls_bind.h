@@ -0,0 +1,15 @@
+/*
+	cls_bind.h
+
+	wren running under lua 5.1+
+	implementation of classes bound from lua with vm:bindClass() and
+	vm:defineLuaClass()
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "vm.h"
+void bvmRelease(carricaVM *cvm);
+int bvmLuaBindClass(lua_State *L);
+int bvmLuaDefineClass(lua_State *L);
@@ -9,6 +9,10 @@
 */
 
 #include "cls_host.h"
+#include "cls_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define WERR(x) { wrenError(vm, x); return; }
 
@@ -26,6 +30,8 @@ void hvmName(WrenVM* vm) {
 	}
 }
 
+// the value of a constant lua defined, by name, for when it isn't known until
+// run time (a defined name is a plain variable, and cheaper)
 void hvmConst(WrenVM* vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
 	if (!vmIsValid(cvm)) 
@@ -36,16 +42,8 @@ void hvmConst(WrenVM* vm) {
 	lua_pushlightuserdata(cvm->L, cvm->name);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	lua_getfield(cvm->L, -1, name);
-	if (lua_type(cvm->L, -1) != LUA_TNIL) {
-		// get a ref to this for later
-		lua_pushstring(cvm->L, name);
-		int r = luaL_ref(cvm->L, -3);
-		wrenSetSlotDouble(vm, 0, (double)r);
-		lua_pop(cvm->L, 1);
-	} else {
-		wrenSetSlotDouble(vm, 0, -1);
-		lua_pop(cvm->L, 2);
-	}
+	wrenSetSlotFromLua(cvm, 0, -1);
+	lua_pop(cvm->L, 2);
 }
 
 void hvmRef(WrenVM* vm) {
@@ -69,247 +67,314 @@ void hvmRef(WrenVM* vm) {
 	}
 }
 
-void hvmCall0(WrenVM* vm) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		lua_call(cvm->L, 0, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
+// push the handler table and the handler the reference in slot 1 names, or tell
+// Wren what went wrong (with nothing pushed) and return false
+static bool hvmPushHandler(WrenVM *vm, carricaVM *cvm, const char *name) {
+	const char *err = NULL;
+	if (!vmIsValid(cvm))
+		err = "called on an invalid VM instance";
+	else if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM)
+		err = "called with bad parameter, number reference expected as first param";
+	else if ((int)wrenGetSlotDouble(vm, 1) == -1)
+		err = "called with bad parameter, reference passed is invalid";
+	else {
+		lua_pushlightuserdata(cvm->L, cvm);
+		lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+		lua_rawgeti(cvm->L, -1, (int)wrenGetSlotDouble(vm, 1));
+		if (lua_type(cvm->L, -1) == LUA_TFUNCTION) return true;
 		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+		err = "failed, no handler could be found";
 	}
+	snprintf(cvm->buffer, 256, "%s %s", name, err);
+	wrenError(vm, cvm->buffer);
+	return false;
 }
 
-void hvmCall1(WrenVM* vm) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		lua_call(cvm->L, 1, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
-	}
+// push the arguments in slot 2 onwards, after the handler, returning how many
+static int hvmPushArgs(WrenVM *vm, carricaVM *cvm) {
+	int args = wrenGetSlotCount(vm) - 2;
+	lua_checkstack(cvm->L, args + 1);
+	for (int i = 0; i < args; i++) luaPushFromWrenSlot(cvm, i + 2);
+	return args;
 }
 
-void hvmCall2(WrenVM* vm) {
+// every arity of Host.call() comes here, the slot count says how many we got
+void hvmCall(WrenVM* vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		lua_call(cvm->L, 2, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
-	}
+	if (!hvmPushHandler(vm, cvm, "Host.call()")) return;
+	vmLuaCall(cvm, hvmPushArgs(vm, cvm), 1);
+	// marshal the return into a wren form
+	wrenSetSlotFromLua(cvm, 0, -1);
+	lua_pop(cvm->L, 2);
 }
 
-void hvmCall3(WrenVM* vm) {
+// Host.callv(ref, list), the elements of a List or Array are the arguments
+void hvmCallV(WrenVM* vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		lua_call(cvm->L, 3, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
+	lua_State *L = cvm->L;
+	WrenType type = wrenGetSlotType(vm, 2);
+	vmWrenReReference *reref = (type == WREN_TYPE_FOREIGN) ? wrenGetSlotForeign(vm, 2) : NULL;
+	if ((type != WREN_TYPE_LIST) && ((reref == NULL) || (reref->type != VM_WREN_SHARE_ARRAY)))
+		WERR("Host.callv() called with bad parameter, List or Array expected as second param")
+	if (!hvmPushHandler(vm, cvm, "Host.callv()")) return;
+	int args;
+	if (type == WREN_TYPE_LIST) {
+		args = wrenGetListCount(vm, 2);
+		if (!lua_checkstack(L, args + 1)) {
+			lua_pop(L, 2);
+			WERR("Host.callv() called with too many arguments for lua")
+		}
+		wrenEnsureSlots(vm, 4);
+		for (int i = 0; i < args; i++) {
+			wrenGetListElement(vm, 2, i, 3);
+			luaPushFromWrenSlot(cvm, 3);
+		}
 	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+		int base;
+		args = avmPushTable(cvm, reref, &base);
+		int t = lua_gettop(L);
+		if (!lua_checkstack(L, args + 1)) {
+			lua_pop(L, 3);
+			WERR("Host.callv() called with too many arguments for lua")
+		}
+		for (int i = 1; i <= args; i++) lua_rawgeti(L, t, base + i);
+		lua_remove(L, t);
 	}
+	vmLuaCall(cvm, args, 1);
+	wrenSetSlotFromLua(cvm, 0, -1);
+	lua_pop(L, 2);
 }
 
-void hvmCall4(WrenVM* vm) {
+// Host.callMulti(ref, ...), every result of the handler goes into an Array
+// kept by the VM for this, so it's filled again by the next call
+void hvmCallMulti(WrenVM* vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		luaPushFromWrenSlot(cvm, 5);
-		lua_call(cvm->L, 4, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+	lua_State *L = cvm->L;
+	int top = lua_gettop(L);
+	if (!hvmPushHandler(vm, cvm, "Host.callMulti()")) return;
+	vmLuaCall(cvm, hvmPushArgs(vm, cvm), LUA_MULTRET);
+	if (cvm->multi == NULL) {
+		if (cvm->handle.Array == NULL) cvm->handle.Array = lcvmGetClassHandle(cvm, "carrica", "Array");
+		wrenSetSlotHandle(vm, 1, cvm->handle.Array);
+		vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 1, VM_REREF_SIZE);
+		ref->type = VM_WREN_SHARE_ARRAY;
+		ref->pref = avmLuaNewArray(cvm);
+		ref->cvm = cvm;
+		ref->view = false;
+		cvm->multi = wrenGetSlotHandle(vm, 0);
+	} else
+		wrenSetSlotHandle(vm, 0, cvm->multi);
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	avmLuaReplace(cvm, reref->pref, top + 2, lua_gettop(L) - top - 1);
+	lua_settop(L, top);
+}
+
+// ********************************************************************************
+// the command buffer, Host.post() queues a call without crossing into lua and
+// vm:drainCommands() makes all of them in one go later
+
+static unsigned char* hvmPostReserve(vmCommandBuffer *b, int n) {
+	if (b->size + n > b->capacity) {
+		while (b->size + n > b->capacity) b->capacity = b->capacity ? b->capacity * 2 : 1024;
+		b->data = realloc(b->data, b->capacity);
 	}
+	unsigned char *p = b->data + b->size;
+	b->size += n;
+	return p;
 }
 
-void hvmCall5(WrenVM* vm) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		luaPushFromWrenSlot(cvm, 5);
-		luaPushFromWrenSlot(cvm, 6);
-		lua_call(cvm->L, 5, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+static void hvmPostBytes(vmCommandBuffer *b, int tag, const char *s, int len) {
+	unsigned char *p = hvmPostReserve(b, 5 + len);
+	p[0] = tag;
+	memcpy(p + 1, &len, 4);
+	memcpy(p + 5, s, len);
+}
+
+// foreign arguments can't be written down, so lua holds them until the drain
+static void hvmPostObject(carricaVM *cvm, int slot) {
+	vmCommandBuffer *b = &cvm->post;
+	lua_State *L = cvm->L;
+	lua_pushlightuserdata(L, b);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	if (lua_type(L, -1) != LUA_TTABLE) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushlightuserdata(L, b);
+		lua_pushvalue(L, -2);
+		lua_settable(L, LUA_REGISTRYINDEX);
 	}
+	luaPushFromWrenSlot(cvm, slot);
+	lua_rawseti(L, -2, ++b->objects);
+	lua_pop(L, 1);
+	unsigned char *p = hvmPostReserve(b, 5);
+	p[0] = VM_POST_OBJECT;
+	memcpy(p + 1, &b->objects, 4);
 }
 
-void hvmCall6(WrenVM* vm) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		luaPushFromWrenSlot(cvm, 5);
-		luaPushFromWrenSlot(cvm, 6);
-		luaPushFromWrenSlot(cvm, 7);
-		lua_call(cvm->L, 6, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+// take back a post that went wrong part way, the buffer goes back to size and
+// lua lets go of the objects held after the first objects
+static void hvmPostUndo(carricaVM *cvm, int size, int objects) {
+	vmCommandBuffer *b = &cvm->post;
+	lua_State *L = cvm->L;
+	if (b->objects > objects) {
+		lua_pushlightuserdata(L, b);
+		lua_gettable(L, LUA_REGISTRYINDEX);
+		for (int i = objects + 1; i <= b->objects; i++) {
+			lua_pushnil(L);
+			lua_rawseti(L, -2, i);
+		}
+		lua_pop(L, 1);
+		b->objects = objects;
 	}
+	b->size = size;
 }
 
-void hvmCall7(WrenVM* vm) {
+void hvmPost(WrenVM* vm) {
 	carricaVM *cvm = wrenGetUserData(vm);
 	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		luaPushFromWrenSlot(cvm, 5);
-		luaPushFromWrenSlot(cvm, 6);
-		luaPushFromWrenSlot(cvm, 7);
-		luaPushFromWrenSlot(cvm, 8);
-		lua_call(cvm->L, 7, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+		WERR("Host.post() called on an invalid VM instance")
+	vmCommandBuffer *b = &cvm->post;
+	int start = b->size;
+	int objects = b->objects;
+	int args = wrenGetSlotCount(vm) - 2;
+	int len;
+	const char *s;
+	double n;
+	unsigned char *p;
+	if (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM) {
+		int r = (int)wrenGetSlotDouble(vm, 1);
+		if (r == -1)
+			WERR("Host.post() called with bad parameter, reference passed is invalid")
+		p = hvmPostReserve(b, 5);
+		p[0] = VM_POST_REF;
+		memcpy(p + 1, &r, 4);
+	} else if (wrenGetSlotType(vm, 1) == WREN_TYPE_STRING) {
+		s = wrenGetSlotBytes(vm, 1, &len);
+		hvmPostBytes(b, VM_POST_NAME, s, len);
+	} else
+		WERR("Host.post() called with bad parameter, number reference or handler name expected as first param")
+	*hvmPostReserve(b, 1) = args;
+	for (int i = 2; i < args + 2; i++) {
+		switch (wrenGetSlotType(vm, i)) {
+			case WREN_TYPE_NULL:
+				*hvmPostReserve(b, 1) = VM_POST_NULL;
+				break;
+			case WREN_TYPE_BOOL:
+				*hvmPostReserve(b, 1) = wrenGetSlotBool(vm, i) ? VM_POST_TRUE : VM_POST_FALSE;
+				break;
+			case WREN_TYPE_NUM:
+				n = wrenGetSlotDouble(vm, i);
+				p = hvmPostReserve(b, 9);
+				p[0] = VM_POST_NUM;
+				memcpy(p + 1, &n, 8);
+				break;
+			case WREN_TYPE_STRING:
+				s = wrenGetSlotBytes(vm, i, &len);
+				hvmPostBytes(b, VM_POST_STRING, s, len);
+				break;
+			default:
+				if (!wrenSlotIsLuaSafe(cvm, i)) {
+					hvmPostUndo(cvm, start, objects);
+					WERR("Host.post() called with bad parameter, a List or Map can't go to lua")
+				}
+				hvmPostObject(cvm, i);
+				break;
+		}
 	}
 }
 
-void hvmCall8(WrenVM* vm) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) 
-		WERR("Host.call() called on an invalid VM instance")
-	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) 
-		WERR("Host.call() called with bad parameter, number reference expected as first param")
-	int r = (int)wrenGetSlotDouble(vm, 1);
-	if (r == -1)
-		WERR("Host.call() called with bad parameter, reference passed is invalid")
-	lua_pushlightuserdata(cvm->L, cvm);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_rawgeti(cvm->L, -1, r);
-	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
-		luaPushFromWrenSlot(cvm, 2);
-		luaPushFromWrenSlot(cvm, 3);
-		luaPushFromWrenSlot(cvm, 4);
-		luaPushFromWrenSlot(cvm, 5);
-		luaPushFromWrenSlot(cvm, 6);
-		luaPushFromWrenSlot(cvm, 7);
-		luaPushFromWrenSlot(cvm, 8);
-		luaPushFromWrenSlot(cvm, 9);
-		lua_call(cvm->L, 8, 1);
-		// marshal the return into a wren form
-		wrenSetSlotFromLua(cvm, 0, -1);
-		lua_pop(cvm->L, 2);
-	} else {
-		lua_pop(cvm->L, 2);
-		WERR("Host.call() failed, no handler could be found")
+// vm:drainCommands([handlerTable]), make every posted call in order, a named
+// handler is looked for in handlerTable first (when given) then the VM's own,
+// returns how many calls were made; a handler that errors leaves the rest
+// queued for the next drain
+int hvmLuaDrain(lua_State *L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".drainCommands()");
+	bool named = lua_type(L, 2) == LUA_TTABLE;
+	lua_settop(L, 2);
+	lua_pushlightuserdata(L, cvm);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	vmCommandBuffer *b = &cvm->post;
+	int calls = 0;
+	int len;
+	double n;
+	// a handler can post more, which we get to before returning, as can a lua
+	// __index on handlerTable (or a __gc) run by a lookup here, so the buffer may
+	// move and we only keep our place in it as an offset
+	while (b->read < b->size) {
+		int at = b->read;
+		if (b->data[at] == VM_POST_REF) {
+			int r;
+			memcpy(&r, b->data + at + 1, 4);
+			lua_rawgeti(L, 3, r);
+			at += 5;
+		} else {
+			memcpy(&len, b->data + at + 1, 4);
+			lua_pushlstring(L, (const char*)b->data + at + 5, len);
+			at += 5 + len;
+			if (named) {
+				lua_pushvalue(L, -1);
+				lua_gettable(L, 2);
+				if (lua_isnil(L, -1)) {
+					lua_pop(L, 1);
+					lua_gettable(L, 3);
+				} else
+					lua_remove(L, -2);
+			} else
+				lua_gettable(L, 3);
+		}
+		int args = b->data[at++];
+		lua_checkstack(L, args + 2);
+		for (int i = 0; i < args; i++) {
+			switch (b->data[at]) {
+				case VM_POST_NULL: lua_pushnil(L); at++; break;
+				case VM_POST_FALSE: lua_pushboolean(L, 0); at++; break;
+				case VM_POST_TRUE: lua_pushboolean(L, 1); at++; break;
+				case VM_POST_NUM:
+					memcpy(&n, b->data + at + 1, 8);
+					lua_pushnumber(L, n);
+					at += 9;
+					break;
+				case VM_POST_STRING:
+					memcpy(&len, b->data + at + 1, 4);
+					lua_pushlstring(L, (const char*)b->data + at + 5, len);
+					at += 5 + len;
+					break;
+				default:
+					memcpy(&len, b->data + at + 1, 4);
+					lua_pushlightuserdata(L, b);
+					lua_gettable(L, LUA_REGISTRYINDEX);
+					lua_rawgeti(L, -1, len);
+					lua_remove(L, -2);
+					at += 5;
+					break;
+			}
+		}
+		b->read = at;
+		if (lua_type(L, -args - 1) != LUA_TFUNCTION) {
+			lua_pop(L, args + 1);
+			luaL_error(L, "carrica -> .drainCommands() found no handler for a posted call");
+		}
+		vmLuaCall(cvm, args, 0);
+		calls++;
 	}
+	b->size = 0;
+	b->read = 0;
+	b->objects = 0;
+	lua_pushlightuserdata(L, b);
+	lua_pushnil(L);
+	lua_settable(L, LUA_REGISTRYINDEX);
+	lua_pushinteger(L, calls);
+	return 1;
+}
+
+// let go of the command buffer and the callMulti() Array, when the VM goes
+void hvmRelease(carricaVM *cvm) {
+	if (cvm->multi) wrenReleaseHandle(cvm->vm, cvm->multi);
+	free(cvm->post.data);
+	lua_pushlightuserdata(cvm->L, &cvm->post);
+	lua_pushnil(cvm->L);
+	lua_settable(cvm->L, LUA_REGISTRYINDEX);
 }
 
 // ********************************************************************************
@@ -319,15 +384,48 @@ const vmForeignMethodDef _h_func[] = {
 	{ true, "name", hvmName },
 	{ true, "const(_)", hvmConst },
 	{ true, "ref(_)", hvmRef },
-	{ true, "call(_)", hvmCall0 },
-	{ true, "call(_,_)", hvmCall1 },
-	{ true, "call(_,_,_)", hvmCall2 },
-	{ true, "call(_,_,_,_)", hvmCall3 },
-	{ true, "call(_,_,_,_,_)", hvmCall4 },
-	{ true, "call(_,_,_,_,_,_)", hvmCall5 },
-	{ true, "call(_,_,_,_,_,_,_)", hvmCall6 },
-	{ true, "call(_,_,_,_,_,_,_,_)", hvmCall7 },
-	{ true, "call(_,_,_,_,_,_,_,_,_)", hvmCall8 },
+	{ true, "call(_)", hvmCall },
+	{ true, "call(_,_)", hvmCall },
+	{ true, "call(_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "call(_,_,_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCall },
+	{ true, "callv(_,_)", hvmCallV },
+	{ true, "callMulti(_)", hvmCallMulti },
+	{ true, "callMulti(_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "callMulti(_,_,_,_,_,_,_,_,_,_,_,_,_,_,_,_)", hvmCallMulti },
+	{ true, "post(_)", hvmPost },
+	{ true, "post(_,_)", hvmPost },
+	{ true, "post(_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_,_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_,_,_,_,_)", hvmPost },
+	{ true, "post(_,_,_,_,_,_,_,_,_)", hvmPost },
 	{ false, NULL, NULL }
 };
 
@@ -10,4 +10,6 @@
 
 #include "vm.h"
 extern const vmForeignModule vmiHost;
+int hvmLuaDrain(lua_State *L);
+void hvmRelease(carricaVM *cvm);
 
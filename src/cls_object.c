@@ -0,0 +1,435 @@
+/*
+	cls_object.c
+
+	wren running under lua 5.1+
+	implementation of Wren objects held by lua, from vm:getClassObj() or
+	handed back by a call, and of handles to top level variables
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "cls_object.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Wren won't take a longer method name than this
+#define OVM_MAX_NAME		64
+
+// the key in a proxy metatable that marks it as one of ours, the value is the box
+// holding the VM, emptied when the VM is released so nothing reaches into it
+static char ovmTag;
+
+static carricaVM *ovmBoxed(lua_State *L, int idx) {
+	carricaVM **box = lua_touserdata(L, idx);
+	return *box;
+}
+
+// ********************************************************************************
+// proxies, a userdata holding the handle with a metatable for it's class
+
+vmWrenObject *ovmLuaTest(lua_State *L, int idx) {
+	if (lua_type(L, idx) != LUA_TUSERDATA || !lua_getmetatable(L, idx)) return NULL;
+	vmWrenObject *o = lua_touserdata(L, idx < 0 ? idx - 1 : idx);
+	lua_pushlightuserdata(L, &ovmTag);
+	lua_rawget(L, -2);
+	bool ours = !lua_isnil(L, -1);
+	lua_pop(L, 2);
+	return ours ? o : NULL;
+}
+
+void ovmFree(vmWrenObject *o) {
+	carricaVM *cvm = o->cvm;
+	if (cvm == NULL) return;
+	if (o->prev) o->prev->next = o->next;
+	else cvm->objects.live = o->next;
+	if (o->next) o->next->prev = o->prev;
+	wrenReleaseHandle(cvm->vm, o->handle);
+	o->cvm = NULL;
+	o->handle = NULL;
+	o->prev = NULL;
+	o->next = NULL;
+}
+
+static int ovmGC(lua_State *L) {
+	ovmFree(lua_touserdata(L, 1));
+	return 0;
+}
+
+static vmWrenObject *ovmCheck(lua_State *L, carricaVM *cvm) {
+	vmWrenObject *o = ovmLuaTest(L, 1);
+	if (o == NULL) luaL_error(L, "carrica -> a Wren method needs the object it is called on, use ':'");
+	if (o->cvm == NULL || o->cvm != cvm) luaL_error(L, "carrica -> Wren object used after it's VM was released or freeClassObj()");
+	return o;
+}
+
+// ********************************************************************************
+// methods, the handles for a name are found once per class and kept by the VM
+
+static vmObjectMethod *ovmMethod(vmObjectClass *c, const char *name) {
+	vmObjectMethod *m = NULL;
+	HASH_FIND_STR(c->methods, name, m);
+	if (m) return m;
+	m = calloc(sizeof(vmObjectMethod), 1);
+	if (m) m->name = strdup(name);
+	if (m == NULL || m->name == NULL) {
+		free(m);
+		return NULL;
+	}
+	m->getter = -1;
+	HASH_ADD_KEYPTR(hh, c->methods, m->name, strlen(m->name), m);
+	return m;
+}
+
+// a call with no arguments is "name()" when the class has it, the getter otherwise
+static WrenHandle *ovmCallHandle(carricaVM *cvm, vmObjectMethod *m, int args) {
+	if (m->call[args]) return m->call[args];
+	char *p = cvm->buffer + snprintf(cvm->buffer, 256, "%s(", m->name);
+	for (int i = 0; i < args; i++) {
+		*p++ = '_';
+		*p++ = ',';
+	}
+	if (args > 0) p--;
+	p[0] = ')';
+	p[1] = 0;
+	if (args == 0) {
+		if (m->getter < 0) m->getter = !wrenHasMethod(cvm->vm, 0, cvm->buffer);
+		if (m->getter) p[-1] = 0;
+	}
+	m->call[args] = wrenMakeCallHandle(cvm->vm, cvm->buffer);
+	return m->call[args];
+}
+
+static int ovmResult(carricaVM *cvm, WrenInterpretResult r) {
+	vmFlushOutput(cvm);
+	if (r != WREN_RESULT_SUCCESS || !wrenSlotIsLuaSafe(cvm, 0)) return 0;
+	luaPushFromWrenSlot(cvm, 0);
+	return 1;
+}
+
+// obj:method(...), upvalues are the method and the box of the VM it was found for
+static int ovmCall(lua_State *L) {
+	vmObjectMethod *m = lua_touserdata(L, lua_upvalueindex(1));
+	carricaVM *cvm = ovmBoxed(L, lua_upvalueindex(2));
+	vmWrenObject *o = ovmCheck(L, cvm);
+	int args = lua_gettop(L) - 1;
+	if (args > VM_OBJECT_ARGS) luaL_error(L, "carrica -> Wren method '%s' called with more than %d arguments", m->name, VM_OBJECT_ARGS);
+	wrenEnsureSlots(cvm->vm, args + 1);
+	wrenSetSlotHandle(cvm->vm, 0, o->handle);
+	WrenHandle *h = ovmCallHandle(cvm, m, args);
+	for (int i = 1; i <= args; i++) wrenSetSlotFromLua(cvm, i, i + 1);
+	// lua has been running since we were last in Wren
+	cvm->luaEpoch++;
+	return ovmResult(cvm, wrenCall(cvm->vm, h));
+}
+
+// the __index of a class's method table, upvalues are the box and the class,
+// the closure made is kept in the table so this only runs once per name
+static int ovmResolve(lua_State *L) {
+	carricaVM *cvm = ovmBoxed(L, lua_upvalueindex(1));
+	if (lua_type(L, 2) != LUA_TSTRING) return 0;
+	if (cvm == NULL) luaL_error(L, "carrica -> Wren object used after it's VM was released");
+	size_t len;
+	const char *name = lua_tolstring(L, 2, &len);
+	if (len > OVM_MAX_NAME) luaL_error(L, "carrica -> '%s' is too long for a Wren method name", name);
+	vmObjectMethod *m = ovmMethod(lua_touserdata(L, lua_upvalueindex(2)), name);
+	if (m == NULL) luaL_error(L, "carrica -> out of memory finding Wren method '%s'", name);
+	lua_pushlightuserdata(L, m);
+	lua_pushvalue(L, lua_upvalueindex(1));
+	lua_pushcclosure(L, ovmCall, 2);
+	lua_pushvalue(L, 2);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, 1);
+	return 1;
+}
+
+// obj.name = value calls the setter "name=(_)", upvalues are the box and the class
+static int ovmNewIndex(lua_State *L) {
+	carricaVM *cvm = ovmBoxed(L, lua_upvalueindex(1));
+	vmWrenObject *o = ovmCheck(L, cvm);
+	const char *name = luaL_checkstring(L, 2);
+	if (strlen(name) > OVM_MAX_NAME) luaL_error(L, "carrica -> '%s' is too long for a Wren method name", name);
+	vmObjectMethod *m = ovmMethod(lua_touserdata(L, lua_upvalueindex(2)), name);
+	if (m == NULL) luaL_error(L, "carrica -> out of memory finding Wren method '%s'", name);
+	if (m->setter == NULL) {
+		snprintf(cvm->buffer, 256, "%s=(_)", name);
+		m->setter = wrenMakeCallHandle(cvm->vm, cvm->buffer);
+	}
+	wrenEnsureSlots(cvm->vm, 2);
+	wrenSetSlotHandle(cvm->vm, 0, o->handle);
+	wrenSetSlotFromLua(cvm, 1, 3);
+	cvm->luaEpoch++;
+	wrenCall(cvm->vm, m->setter);
+	vmFlushOutput(cvm);
+	return 0;
+}
+
+static int ovmToString(lua_State *L) {
+	lua_pushfstring(L, "%s: %p", lua_tostring(L, lua_upvalueindex(1)), lua_touserdata(L, 1));
+	return 1;
+}
+
+// the metatable for objects of the class of slot, made the first time one is seen
+static void ovmPushMeta(carricaVM *cvm, int slot) {
+	lua_State *L = cvm->L;
+	lua_pushlightuserdata(L, &cvm->objects);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if (lua_isnil(L, -1)) {
+		lua_pop(L, 1);
+		lua_newtable(L);
+		lua_pushlightuserdata(L, &cvm->objects);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, LUA_REGISTRYINDEX);
+	}
+	const void *id = wrenGetSlotClassIdentity(cvm->vm, slot);
+	vmObjectClass *c = NULL;
+	HASH_FIND_PTR(cvm->objects.classes, &id, c);
+	if (c) {
+		lua_pushlightuserdata(L, c);
+		lua_rawget(L, -2);
+		lua_remove(L, -2);
+		return;
+	}
+	c = calloc(sizeof(vmObjectClass), 1);
+	if (c == NULL) luaL_error(L, "carrica -> out of memory for a Wren class");
+	c->id = id;
+	// hold the class in a spare slot long enough to take a handle on it
+	int spare = wrenGetSlotCount(cvm->vm);
+	wrenEnsureSlots(cvm->vm, spare + 1);
+	wrenGetSlotClass(cvm->vm, slot, spare);
+	c->handle = wrenGetSlotHandle(cvm->vm, spare);
+	HASH_ADD_PTR(cvm->objects.classes, id, c);
+	const char *cls = wrenGetSlotClassName(cvm->vm, slot);
+	lua_newtable(L);
+	// the box first, everything else closes over it
+	carricaVM **box = lua_newuserdata(L, sizeof(carricaVM*));
+	*box = cvm;
+	lua_pushlightuserdata(L, &ovmTag);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, -4);
+	// mt.__index is the method table, which fills itself from ovmResolve()
+	lua_newtable(L);
+	lua_newtable(L);
+		lua_pushvalue(L, -3);
+		lua_pushlightuserdata(L, c);
+		lua_pushcclosure(L, ovmResolve, 2);
+	lua_setfield(L, -2, "__index");
+	lua_setmetatable(L, -2);
+	lua_setfield(L, -3, "__index");
+	// mt.__newindex takes the box off the stack with it
+		lua_pushlightuserdata(L, c);
+		lua_pushcclosure(L, ovmNewIndex, 2);
+	lua_setfield(L, -2, "__newindex");
+		lua_pushstring(L, cls);
+		lua_pushcclosure(L, ovmToString, 1);
+	lua_setfield(L, -2, "__tostring");
+		lua_pushcfunction(L, ovmGC);
+	lua_setfield(L, -2, "__gc");
+	lua_pushlightuserdata(L, c);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, -4);
+	lua_remove(L, -2);
+}
+
+// the proxies lua holds, by the identity of their object, weak so they are
+// still collected, and kept in the registry under &objects.classes
+static void ovmPushProxies(carricaVM *cvm) {
+	lua_State *L = cvm->L;
+	lua_pushlightuserdata(L, &cvm->objects.classes);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if (!lua_isnil(L, -1)) return;
+	lua_pop(L, 1);
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushstring(L, "v");
+	lua_setfield(L, -2, "__mode");
+	lua_setmetatable(L, -2);
+	lua_pushlightuserdata(L, &cvm->objects.classes);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+// an object already in lua gets the same proxy back, so it is == to itself
+void ovmLuaPush(carricaVM *cvm, int slot) {
+	lua_State *L = cvm->L;
+	void *id = (void*)wrenGetSlotIdentity(cvm->vm, slot);
+	ovmPushProxies(cvm);
+	lua_pushlightuserdata(L, id);
+	lua_rawget(L, -2);
+	vmWrenObject *o = lua_touserdata(L, -1);
+	// a proxy let go by freeClassObj() may be here yet, for an object long gone
+	if (o && o->cvm == cvm) {
+		lua_remove(L, -2);
+		return;
+	}
+	lua_pop(L, 1);
+	o = lua_newuserdata(L, sizeof(vmWrenObject));
+	o->cvm = cvm;
+	o->handle = wrenGetSlotHandle(cvm->vm, slot);
+	o->prev = NULL;
+	o->next = cvm->objects.live;
+	if (o->next) o->next->prev = o;
+	cvm->objects.live = o;
+	ovmPushMeta(cvm, slot);
+	lua_setmetatable(L, -2);
+	lua_pushlightuserdata(L, id);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, -4);
+	lua_remove(L, -2);
+}
+
+// let go of every handle before the VM goes, lua may hold the proxies a while yet
+void ovmRelease(carricaVM *cvm) {
+	lua_State *L = cvm->L;
+	while (cvm->objects.live) ovmFree(cvm->objects.live);
+	vmObjectClass *c = NULL;
+	vmObjectClass *ctmp = NULL;
+	HASH_ITER(hh, cvm->objects.classes, c, ctmp) {
+		HASH_DEL(cvm->objects.classes, c);
+		vmObjectMethod *m = NULL;
+		vmObjectMethod *tmp = NULL;
+		HASH_ITER(hh, c->methods, m, tmp) {
+			HASH_DEL(c->methods, m);
+			for (int i = 0; i <= VM_OBJECT_ARGS; i++)
+				if (m->call[i]) wrenReleaseHandle(cvm->vm, m->call[i]);
+			if (m->setter) wrenReleaseHandle(cvm->vm, m->setter);
+			free(m->name);
+			free(m);
+		}
+		wrenReleaseHandle(cvm->vm, c->handle);
+		free(c);
+	}
+	// empty the boxes so old metatables can't find their way back
+	lua_pushlightuserdata(L, &cvm->objects);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if (lua_istable(L, -1)) {
+		lua_pushnil(L);
+		while (lua_next(L, -2)) {
+			lua_pushlightuserdata(L, &ovmTag);
+			lua_rawget(L, -2);
+			*(carricaVM**)lua_touserdata(L, -1) = NULL;
+			lua_pop(L, 2);
+		}
+	}
+	lua_pop(L, 1);
+	lua_pushlightuserdata(L, &cvm->objects);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	lua_pushlightuserdata(L, &cvm->objects.classes);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+// ********************************************************************************
+// variable handles, the module and index of a top level variable found once
+
+static vmWrenVariable *ovmCheckVariable(lua_State *L) {
+	vmWrenVariable *v = luaL_checkudata(L, 1, LUA_NAME_SVARIABLE);
+	if (v->obj.cvm == NULL) luaL_error(L, "carrica -> variable handle used after it's VM was released");
+	return v;
+}
+
+// vm:getVariableHandle(module, name)
+int ovmLuaGetVariableHandle(lua_State *L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".getVariableHandle()");
+	const char *module = luaL_checkstring(L, 2);
+	const char *name = luaL_checkstring(L, 3);
+	// the userdata first, so nothing can raise while we hold the module handle
+	vmWrenVariable *v = lua_newuserdata(L, sizeof(vmWrenVariable));
+	v->obj.cvm = NULL;
+	luaL_getmetatable(L, LUA_NAME_SVARIABLE);
+	lua_setmetatable(L, -2);
+	WrenHandle *h = wrenGetModuleHandle(cvm->vm, module);
+	if (h == NULL) luaL_error(L, "carrica -> could not find module '%s'", module);
+	int index = wrenGetVariableIndex(cvm->vm, h, name);
+	if (index < 0) {
+		wrenReleaseHandle(cvm->vm, h);
+		luaL_error(L, "carrica -> could not find variable '%s' in module '%s'", name, module);
+	}
+	v->obj.cvm = cvm;
+	v->obj.handle = h;
+	v->obj.prev = NULL;
+	v->obj.next = cvm->objects.live;
+	if (v->obj.next) v->obj.next->prev = &v->obj;
+	cvm->objects.live = &v->obj;
+	v->index = index;
+	return 1;
+}
+
+// vm:getVariables(module, { names }, [out]), the values into out (or a new
+// table) by name, a variable that doesn't exist is nil
+int ovmLuaGetVariables(lua_State *L) {
+	carricaVM *cvm = luaL_checkudata(L, 1, LUA_NAME_WRENVM);
+	if (!vmIsValid(cvm)) luaL_error(L, "carrica -> %s called on an invalid VM instance", ".getVariables()");
+	const char *module = luaL_checkstring(L, 2);
+	luaL_checktype(L, 3, LUA_TTABLE);
+	lua_settop(L, 4);
+	if (!lua_istable(L, 4)) {
+		lua_newtable(L);
+		lua_replace(L, 4);
+	}
+	int count = 0;
+	for (;;) {
+		lua_rawgeti(L, 3, count + 1);
+		bool name = (lua_type(L, -1) == LUA_TSTRING);
+		lua_pop(L, 1);
+		if (!name) break;
+		count++;
+	}
+	WrenHandle *h = wrenGetModuleHandle(cvm->vm, module);
+	if (h == NULL) luaL_error(L, "carrica -> could not find module '%s'", module);
+	// every value goes to a slot of it's own and the handle is let go before
+	// any of them reach lua, which can raise an error
+	wrenEnsureSlots(cvm->vm, count ? count : 1);
+	for (int i = 0; i < count; i++) {
+		lua_rawgeti(L, 3, i + 1);
+		int index = wrenGetVariableIndex(cvm->vm, h, lua_tostring(L, -1));
+		lua_pop(L, 1);
+		if (index >= 0) wrenGetVariableAt(cvm->vm, h, index, i);
+		else wrenSetSlotNull(cvm->vm, i);
+	}
+	wrenReleaseHandle(cvm->vm, h);
+	for (int i = 0; i < count; i++) {
+		lua_rawgeti(L, 3, i + 1);
+		if (wrenSlotIsLuaSafe(cvm, i)) luaPushFromWrenSlot(cvm, i);
+		else lua_pushnil(L);
+		lua_rawset(L, 4);
+	}
+	return 1;
+}
+
+// v:get(), a List or Map is nil as lua can't have it
+static int ovmLuaVariableGet(lua_State *L) {
+	vmWrenVariable *v = ovmCheckVariable(L);
+	carricaVM *cvm = v->obj.cvm;
+	wrenEnsureSlots(cvm->vm, 1);
+	wrenGetVariableAt(cvm->vm, v->obj.handle, v->index, 0);
+	if (!wrenSlotIsLuaSafe(cvm, 0)) return 0;
+	luaPushFromWrenSlot(cvm, 0);
+	return 1;
+}
+
+// v:set(value)
+static int ovmLuaVariableSet(lua_State *L) {
+	vmWrenVariable *v = ovmCheckVariable(L);
+	carricaVM *cvm = v->obj.cvm;
+	lua_settop(L, 2);
+	if (!luaIndexIsWrenSafe(cvm, 2))
+		luaL_error(L, "carrica -> variable:set() value must be nil, a boolean, number, string, Array, Table or Wren object");
+	wrenEnsureSlots(cvm->vm, 1);
+	wrenSetSlotFromLua(cvm, 0, 2);
+	wrenSetVariableAt(cvm->vm, v->obj.handle, v->index, 0);
+	return 0;
+}
+
+luaL_Reg ovmVariableMeta[] = {
+	{ "get", ovmLuaVariableGet },
+	{ "set", ovmLuaVariableSet },
+	{ NULL, NULL }
+};
+
+int ovmLuaVariableGC(lua_State *L) {
+	return ovmGC(L);
+}
@@ -0,0 +1,20 @@
+/*
+	cls_object.h
+
+	wren running under lua 5.1+
+	implementation of Wren objects held by lua, from vm:getClassObj() or
+	handed back by a call, and of handles to top level variables
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "vm.h"
+vmWrenObject *ovmLuaTest(lua_State *L, int idx);
+void ovmLuaPush(carricaVM *cvm, int slot);
+void ovmFree(vmWrenObject *o);
+void ovmRelease(carricaVM *cvm);
+int ovmLuaGetVariableHandle(lua_State *L);
+int ovmLuaGetVariables(lua_State *L);
+int ovmLuaVariableGC(lua_State *L);
+extern luaL_Reg ovmVariableMeta[];
@@ -0,0 +1,562 @@
+/*
+	cls_struct.c
+
+	wren running under lua 5.1+
+	implementation of structs defined from lua with carrica.defineStruct()
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "cls_struct.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WERR(x) { wrenError(vm, x); return; }
+
+// a struct can't have more fields than we have getters and setters for
+#define SVM_MAX_FIELDS		64
+// every struct gets a module of it's own, named with this in front
+#define SVM_MODULE_PREFIX	"struct/"
+
+typedef struct _svmType {
+	const char *name;
+	const char *ctype;
+	int size;
+} svmType;
+
+// indexed by VM_STRUCT_*
+static const svmType svmTypes[] = {
+	{ NULL, NULL, 0 },
+	{ "i8", "int8_t", 1 },
+	{ "u8", "uint8_t", 1 },
+	{ "i16", "int16_t", 2 },
+	{ "u16", "uint16_t", 2 },
+	{ "i32", "int32_t", 4 },
+	{ "u32", "uint32_t", 4 },
+	{ "f32", "float", 4 },
+	{ "f64", "double", 8 },
+	{ NULL, NULL, 0 }
+};
+
+// names a field can't have, Wren keywords and the methods every struct has
+static const char *svmReserved[] = {
+	"as", "break", "class", "construct", "continue", "else", "false", "for", "foreign",
+	"if", "import", "in", "is", "null", "return", "static", "super", "this", "true",
+	"var", "while", "count", "index", "seek", "new", "array", "iterate", "iteratorValue",
+	"ptr", "base", "ctype", NULL
+};
+
+// every definition made, a struct's id is it's place here, VMs on other threads
+// look in here so it's only touched holding vmsLock(), a definition itself
+// never changes once it's in the list
+static vmStructDef **svmDefs = NULL;
+static int svmDefCount = 0;
+static int svmDefMax = 0;
+
+// ********************************************************************************
+// storage
+
+static vmStructBlock* svmNew(vmStructDef *def, int count) {
+	vmStructBlock *block = calloc(1, sizeof(vmStructBlock));
+	block->refCount = 1;
+	block->count = count;
+	block->def = def;
+	block->data = calloc(count, def->size);
+	return block;
+}
+
+// drop a reference, the records go when Wren and every lua proxy let go
+void svmRelease(vmStructBlock *block) {
+	if (--block->refCount > 0) return;
+	free(block->data);
+	free(block);
+}
+
+static double svmRead(const unsigned char *p, int type) {
+	switch (type) {
+		case VM_STRUCT_I8: return *(const int8_t*)p;
+		case VM_STRUCT_U8: return *(const uint8_t*)p;
+		case VM_STRUCT_I16: return *(const int16_t*)p;
+		case VM_STRUCT_U16: return *(const uint16_t*)p;
+		case VM_STRUCT_I32: return *(const int32_t*)p;
+		case VM_STRUCT_U32: return *(const uint32_t*)p;
+		case VM_STRUCT_F32: return *(const float*)p;
+		default: return *(const double*)p;
+	}
+}
+
+// integers are truncated and wrap to the size of the field, false (and nothing
+// written) for NaN or an infinity, which no integer field can hold
+static bool svmWrite(unsigned char *p, int type, double v) {
+	if ((type == VM_STRUCT_F32) || (type == VM_STRUCT_F64)) {
+		if (type == VM_STRUCT_F32) *(float*)p = (float)v;
+		else *(double*)p = v;
+		return true;
+	}
+	if (!isfinite(v)) return false;
+	// the low 32 bits, worked out in doubles (which are exact here) so there is
+	// never a cast of a value that doesn't fit
+	double r = fmod(trunc(v), 4294967296.0);
+	if (r < 0) r += 4294967296.0;
+	uint32_t u = (uint32_t)r;
+	switch (type) {
+		case VM_STRUCT_I8: *(int8_t*)p = (int8_t)(uint8_t)u; break;
+		case VM_STRUCT_U8: *(uint8_t*)p = (uint8_t)u; break;
+		case VM_STRUCT_I16: *(int16_t*)p = (int16_t)(uint16_t)u; break;
+		case VM_STRUCT_U16: *(uint16_t*)p = (uint16_t)u; break;
+		case VM_STRUCT_I32: *(int32_t*)p = (int32_t)u; break;
+		default: *(uint32_t*)p = u; break;
+	}
+	return true;
+}
+
+// call holding vmsLock()
+static vmStructDef* svmFind(const char *name) {
+	for (int i = 0; i < svmDefCount; i++)
+		if (!strcmp(svmDefs[i]->name, name)) return svmDefs[i];
+	return NULL;
+}
+
+static vmStructDef* svmFindModule(const char *module) {
+	size_t n = strlen(SVM_MODULE_PREFIX);
+	if (strncmp(module, SVM_MODULE_PREFIX, n)) return NULL;
+	vmsLock();
+	vmStructDef *def = svmFind(module + n);
+	vmsUnlock();
+	return def;
+}
+
+static vmStructDef* svmGetDef(int id) {
+	vmsLock();
+	vmStructDef *def = svmDefs[id];
+	vmsUnlock();
+	return def;
+}
+
+// ********************************************************************************
+// field access, a getter and setter per field position so each field binds
+// straight to a C function that knows where it lives in the record
+
+static void svmGetField(WrenVM *vm, int n) {
+	vmWrenStruct *w = wrenGetSlotForeign(vm, 0);
+	vmStructDef *def = w->block->def;
+	vmStructField *f = &def->field[n];
+	wrenSetSlotDouble(vm, 0, svmRead(w->block->data + w->index * def->size + f->offset, f->type));
+}
+
+static void svmSetField(WrenVM *vm, int n) {
+	vmWrenStruct *w = wrenGetSlotForeign(vm, 0);
+	vmStructDef *def = w->block->def;
+	vmStructField *f = &def->field[n];
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("struct fields only hold numbers")
+	if (!svmWrite(w->block->data + w->index * def->size + f->offset, f->type, wrenGetSlotDouble(vm, 1)))
+		WERR("struct integer fields can not hold NaN or infinity")
+}
+
+#define SVM_FIELD(a, b) \
+static void svmGet##a##_##b(WrenVM *vm) { svmGetField(vm, a * 8 + b); } \
+static void svmSet##a##_##b(WrenVM *vm) { svmSetField(vm, a * 8 + b); }
+#define SVM_FIELD8(a) \
+	SVM_FIELD(a, 0) SVM_FIELD(a, 1) SVM_FIELD(a, 2) SVM_FIELD(a, 3) \
+	SVM_FIELD(a, 4) SVM_FIELD(a, 5) SVM_FIELD(a, 6) SVM_FIELD(a, 7)
+
+SVM_FIELD8(0) SVM_FIELD8(1) SVM_FIELD8(2) SVM_FIELD8(3)
+SVM_FIELD8(4) SVM_FIELD8(5) SVM_FIELD8(6) SVM_FIELD8(7)
+
+#define SVM_GET8(a) svmGet##a##_0, svmGet##a##_1, svmGet##a##_2, svmGet##a##_3, \
+	svmGet##a##_4, svmGet##a##_5, svmGet##a##_6, svmGet##a##_7
+#define SVM_SET8(a) svmSet##a##_0, svmSet##a##_1, svmSet##a##_2, svmSet##a##_3, \
+	svmSet##a##_4, svmSet##a##_5, svmSet##a##_6, svmSet##a##_7
+
+static const WrenForeignMethodFn svmGetters[SVM_MAX_FIELDS] = {
+	SVM_GET8(0), SVM_GET8(1), SVM_GET8(2), SVM_GET8(3),
+	SVM_GET8(4), SVM_GET8(5), SVM_GET8(6), SVM_GET8(7) };
+static const WrenForeignMethodFn svmSetters[SVM_MAX_FIELDS] = {
+	SVM_SET8(0), SVM_SET8(1), SVM_SET8(2), SVM_SET8(3),
+	SVM_SET8(4), SVM_SET8(5), SVM_SET8(6), SVM_SET8(7) };
+
+// ********************************************************************************
+// functions every struct has
+
+void svmCount(WrenVM *vm) {
+	vmWrenStruct *w = wrenGetSlotForeign(vm, 0);
+	wrenSetSlotDouble(vm, 0, w->block->count);
+}
+
+void svmIndex(WrenVM *vm) {
+	vmWrenStruct *w = wrenGetSlotForeign(vm, 0);
+	wrenSetSlotDouble(vm, 0, w->index);
+}
+
+// look at another record of the same block, returning ourself
+void svmSeek(WrenVM *vm) {
+	vmWrenStruct *w = wrenGetSlotForeign(vm, 0);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("seek() needs a number")
+	int i = (int)wrenGetSlotDouble(vm, 1);
+	if (i < 0) i += w->block->count;
+	if ((i < 0) || (i >= w->block->count)) WERR("index out of bounds on struct seek()")
+	w->index = i;
+}
+
+// array_(def, count), a block of count zeroed records
+void svmArray(WrenVM *vm) {
+	if (wrenGetSlotType(vm, 2) != WREN_TYPE_NUM) WERR("array() needs a number")
+	int id = (int)wrenGetSlotDouble(vm, 1);
+	int cnt = (int)wrenGetSlotDouble(vm, 2);
+	if (cnt < 1) WERR("array() needs a count of at least 1")
+	vmWrenStruct *w = wrenSetSlotNewForeign(vm, 0, 0, VM_WSTRUCT_SIZE);
+	w->type = VM_WREN_SHARE_STRUCT;
+	w->cvm = wrenGetUserData(vm);
+	w->index = 0;
+	w->block = svmNew(svmGetDef(id), cnt);
+}
+
+// new_(def) makes a single zeroed record, at_(def, other) looks at the first
+// record of other's block
+void svmAllocate(WrenVM *vm) {
+	vmWrenStruct *w = wrenSetSlotNewForeign(vm, 0, 0, VM_WSTRUCT_SIZE);
+	vmStructDef *def = svmGetDef((int)wrenGetSlotDouble(vm, 1));
+	w->type = VM_WREN_SHARE_STRUCT;
+	w->cvm = wrenGetUserData(vm);
+	w->index = 0;
+	if ((wrenGetSlotCount(vm) > 2) && (wrenGetSlotType(vm, 2) == WREN_TYPE_FOREIGN)) {
+		vmWrenStruct *other = wrenGetSlotForeign(vm, 2);
+		if ((other->type == VM_WREN_SHARE_STRUCT) && (other->block->def == def)) {
+			w->block = other->block;
+			w->block->refCount++;
+			return;
+		}
+	}
+	w->block = svmNew(def, 1);
+}
+
+void svmFinalize(void *obj) {
+	vmWrenStruct *w = obj;
+	svmRelease(w->block);
+}
+
+// ********************************************************************************
+// binding, every struct module comes through here
+
+static WrenForeignMethodFn svmBindMethod(WrenVM* vm, const char* module,
+						const char* className, bool isStatic, const char* signature) {
+	vmStructDef *def = svmFindModule(module);
+	if (def == NULL) return NULL;
+	if (isStatic) return strcmp(signature, "array_(_,_)") ? NULL : svmArray;
+	if (!strcmp(signature, "count")) return svmCount;
+	if (!strcmp(signature, "index")) return svmIndex;
+	if (!strcmp(signature, "seek(_)")) return svmSeek;
+	for (int i = 0; i < def->count; i++) {
+		size_t n = strlen(def->field[i].name);
+		if (strncmp(signature, def->field[i].name, n)) continue;
+		if (signature[n] == 0) return svmGetters[i];
+		if (!strcmp(signature + n, "=(_)")) return svmSetters[i];
+	}
+	return NULL;
+}
+
+static WrenForeignClassMethods svmBindClass(WrenVM* vm, const char* module, const char* className) {
+	WrenForeignClassMethods ret = { NULL, NULL };
+	if (svmFindModule(module) != NULL) {
+		ret.allocate = svmAllocate;
+		ret.finalize = svmFinalize;
+	}
+	return ret;
+}
+
+// ********************************************************************************
+// defining a struct from lua
+
+static bool svmIsName(const char *s) {
+	if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z'))) return false;
+	for (s++; *s; s++)
+		if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') || (*s >= '0' && *s <= '9') || (*s == '_')))
+			return false;
+	return true;
+}
+
+// biggest fields first (then by name), so records pack without padding and
+// the layout doesn't depend on the order lua hands us the fields
+static int svmCompareField(const void *a, const void *b) {
+	const vmStructField *fa = a;
+	const vmStructField *fb = b;
+	int d = svmTypes[fb->type].size - svmTypes[fa->type].size;
+	return d ? d : strcmp(fa->name, fb->name);
+}
+
+// the Wren module for a struct, a foreign class with a getter and setter per field
+static char* svmMakeSource(vmStructDef *def) {
+	size_t max = 1024;
+	for (int i = 0; i < def->count; i++) max += 2 * strlen(def->field[i].name) + 48;
+	char *src = malloc(max);
+	int len = snprintf(src, max,
+		"// made by carrica.defineStruct()\n"
+		"foreign class %s {\n"
+		"\tconstruct new_(def) { }\n"
+		"\tconstruct at_(def, other) { }\n"
+		"\tstatic new() { new_(%d) }\n"
+		"\tstatic array(count) { array_(%d, count) }\n"
+		"\tforeign static array_(def, count)\n\n"
+		"\tforeign count\n"
+		"\tforeign index\n"
+		"\tforeign seek(index)\n"
+		"\t[index] { %s.at_(%d, this).seek(index) }\n"
+		"\titerate(i) {\n"
+		"\t\tif (i == null) return 0\n"
+		"\t\treturn (i + 1 < count) ? i + 1 : false\n"
+		"\t}\n"
+		"\titeratorValue(i) { this[i] }\n\n",
+		def->name, def->id, def->id, def->name, def->id);
+	for (int i = 0; i < def->count; i++)
+		len += snprintf(src + len, max - len, "\tforeign %s\n\tforeign %s=(value)\n",
+			def->field[i].name, def->field[i].name);
+	snprintf(src + len, max - len, "}\n");
+	return src;
+}
+
+// the matching C declaration, for the ffi
+static char* svmMakeCdef(vmStructDef *def) {
+	size_t max = 64 + strlen(def->name);
+	for (int i = 0; i < def->count; i++) max += strlen(def->field[i].name) + 16;
+	char *cdef = malloc(max);
+	int len = snprintf(cdef, max, "struct %s {", def->name);
+	for (int i = 0; i < def->count; i++)
+		len += snprintf(cdef + len, max - len, " %s %s;", svmTypes[def->field[i].type].ctype,
+			def->field[i].name);
+	snprintf(cdef + len, max - len, " };");
+	return cdef;
+}
+
+static void svmFreeDef(vmStructDef *def) {
+	for (int i = 0; i < def->count; i++) free(def->field[i].name);
+	free(def->field);
+	free(def->name);
+	free(def->cdef);
+	free(def);
+}
+
+// read the fields table at idx into a new definition, erroring on anything bad
+static vmStructDef* svmParse(lua_State *L, const char *name, int idx) {
+	vmStructDef *def = calloc(1, sizeof(vmStructDef));
+	def->name = strdup(name);
+	def->field = calloc(SVM_MAX_FIELDS, sizeof(vmStructField));
+	const char *err = NULL;
+	lua_pushnil(L);
+	while ((err == NULL) && lua_next(L, idx)) {
+		const char *fname = (lua_type(L, -2) == LUA_TSTRING) ? lua_tostring(L, -2) : NULL;
+		const char *tname = (lua_type(L, -1) == LUA_TSTRING) ? lua_tostring(L, -1) : "";
+		int type = 1;
+		while (svmTypes[type].name && strcmp(svmTypes[type].name, tname)) type++;
+		if ((fname == NULL) || !svmIsName(fname) || (fname[strlen(fname) - 1] == '_'))
+			err = "carrica -> .defineStruct() field names must be identifiers";
+		else if (svmTypes[type].name == NULL)
+			err = "carrica -> .defineStruct() field types are i8 u8 i16 u16 i32 u32 f32 f64";
+		else if (def->count == SVM_MAX_FIELDS)
+			err = "carrica -> .defineStruct() has too many fields";
+		else {
+			for (int i = 0; svmReserved[i] && (err == NULL); i++)
+				if (!strcmp(svmReserved[i], fname)) err = "carrica -> .defineStruct() field name is reserved";
+			if (err == NULL) {
+				def->field[def->count].name = strdup(fname);
+				def->field[def->count].type = type;
+				def->count++;
+			}
+		}
+		lua_pop(L, 1);
+	}
+	if (err != NULL) {
+		lua_pop(L, 1);
+		svmFreeDef(def);
+		luaL_error(L, "%s", err);
+	}
+	if (def->count == 0) {
+		svmFreeDef(def);
+		luaL_error(L, "carrica -> .defineStruct() needs at least one field");
+	}
+	// lay it out, aligned to the biggest field
+	qsort(def->field, def->count, sizeof(vmStructField), svmCompareField);
+	for (int i = 0; i < def->count; i++) {
+		def->field[i].offset = def->size;
+		def->size += svmTypes[def->field[i].type].size;
+	}
+	int align = svmTypes[def->field[0].type].size;
+	def->size = (def->size + align - 1) / align * align;
+	def->cdef = svmMakeCdef(def);
+	return def;
+}
+
+// hand the declaration to the ffi, if this lua has one
+static void svmFFIDeclare(lua_State *L, const char *cdef) {
+	lua_getglobal(L, "require");
+	if (lua_type(L, -1) != LUA_TFUNCTION) {
+		lua_pop(L, 1);
+		return;
+	}
+	lua_pushstring(L, "ffi");
+	if (lua_pcall(L, 1, 1, 0) || (lua_type(L, -1) != LUA_TTABLE)) {
+		lua_pop(L, 1);
+		return;
+	}
+	lua_getfield(L, -1, "cdef");
+	lua_pushstring(L, cdef);
+	// a struct lua already declared itself is left as it was
+	if (lua_pcall(L, 1, 0, 0)) lua_pop(L, 1);
+	lua_pop(L, 1);
+}
+
+// carrica.defineStruct(name, { field = "type", ... }), returns the C declaration
+// and the ffi type name, defining the same layout again is harmless
+int svmLuaDefine(lua_State *L) {
+	const char *name = luaL_checkstring(L, 1);
+	luaL_checktype(L, 2, LUA_TTABLE);
+	if (!svmIsName(name)) luaL_error(L, "carrica -> .defineStruct() name must be an identifier");
+	vmStructDef *def = svmParse(L, name, 2);
+	// nothing in here can raise a lua error, so the lock is always let go
+	vmsLock();
+	vmStructDef *old = svmFind(name);
+	if (old == NULL) {
+		// keep it, forever, finished before other VMs can see it
+		if (svmDefCount == svmDefMax) {
+			svmDefMax = svmDefMax ? svmDefMax * 2 : 16;
+			svmDefs = realloc(svmDefs, sizeof(vmStructDef*) * svmDefMax);
+		}
+		def->id = svmDefCount;
+		def->ctype = malloc(strlen(name) + 8);
+		sprintf(def->ctype, "struct %s", name);
+		def->module = malloc(strlen(name) + strlen(SVM_MODULE_PREFIX) + 1);
+		sprintf(def->module, "%s%s", SVM_MODULE_PREFIX, name);
+		def->source = svmMakeSource(def);
+		svmDefs[svmDefCount++] = def;
+	}
+	vmsUnlock();
+	if (old != NULL) {
+		bool same = !strcmp(old->cdef, def->cdef);
+		svmFreeDef(def);
+		if (!same) luaL_error(L, "carrica -> .defineStruct() '%s' is already defined differently", name);
+		lua_pushstring(L, old->cdef);
+		lua_pushstring(L, old->ctype);
+		return 2;
+	}
+	carricaModule mod;
+	mod.def.name = def->module;
+	mod.def.source = def->source;
+	mod.bindForeignMethod = svmBindMethod;
+	mod.bindForeignClass = svmBindClass;
+	vmInstallSharedBinaryMod(&mod);
+	svmFFIDeclare(L, def->cdef);
+	lua_pushstring(L, def->cdef);
+	lua_pushstring(L, def->ctype);
+	return 2;
+}
+
+// ********************************************************************************
+// the lua side proxy, a userdata looking at one record, s.ptr is the raw memory
+// of that record and s.base the first of it's block, for the ffi, as in
+// ffi.cast(s.ctype .. '*', s.base)[i]
+
+typedef struct _svmProxy {
+	vmStructBlock *block;
+	int index;
+} svmProxy;
+
+void svmLuaPush(lua_State *L, vmStructBlock *block, int index) {
+	svmProxy *p = lua_newuserdata(L, sizeof(svmProxy));
+	p->block = block;
+	p->index = index;
+	block->refCount++;
+	luaL_getmetatable(L, LUA_NAME_SSTRUCT);
+	lua_setmetatable(L, -2);
+}
+
+// can the proxy at idx go to this VM? only if it imported the struct's module
+bool svmLuaIsImported(carricaVM *cvm, int idx) {
+	svmProxy *p = lua_touserdata(cvm->L, idx);
+	return wrenHasModule(cvm->vm, p->block->def->module);
+}
+
+// a proxy lua hands back becomes a new Wren struct looking at the same record
+void svmLuaToSlot(carricaVM *cvm, int slot, int idx) {
+	svmProxy *p = lua_touserdata(cvm->L, idx);
+	vmStructDef *def = p->block->def;
+	if (!svmLuaIsImported(cvm, idx)) {
+		wrenError(cvm->vm, "VM -> a struct can only go to Wren after it's module is imported");
+		return;
+	}
+	wrenGetVariable(cvm->vm, def->module, def->name, slot);
+	vmWrenStruct *w = wrenSetSlotNewForeign(cvm->vm, slot, slot, VM_WSTRUCT_SIZE);
+	w->type = VM_WREN_SHARE_STRUCT;
+	w->cvm = cvm;
+	w->block = p->block;
+	w->index = p->index;
+	p->block->refCount++;
+}
+
+static vmStructField* svmLuaField(lua_State *L, svmProxy *p, const char *k) {
+	vmStructDef *def = p->block->def;
+	for (int i = 0; i < def->count; i++)
+		if (!strcmp(def->field[i].name, k)) return &def->field[i];
+	return NULL;
+}
+
+static int svmLuaIndex(lua_State *L) {
+	svmProxy *p = luaL_checkudata(L, 1, LUA_NAME_SSTRUCT);
+	vmStructDef *def = p->block->def;
+	if (lua_type(L, 2) == LUA_TSTRING) {
+		const char *k = lua_tostring(L, 2);
+		vmStructField *f = svmLuaField(L, p, k);
+		if (f != NULL)
+			lua_pushnumber(L, svmRead(p->block->data + p->index * def->size + f->offset, f->type));
+		else if (!strcmp(k, "ptr"))
+			lua_pushlightuserdata(L, p->block->data + p->index * def->size);
+		else if (!strcmp(k, "base"))
+			lua_pushlightuserdata(L, p->block->data);
+		else if (!strcmp(k, "index"))
+			lua_pushinteger(L, p->index + 1);
+		else if (!strcmp(k, "ctype"))
+			lua_pushstring(L, def->ctype);
+		else if (!strcmp(k, "count"))
+			lua_pushinteger(L, p->block->count);
+		else
+			lua_pushnil(L);
+		return 1;
+	}
+	// s[i] is record i of the same block, from 1 like everything else in lua
+	int i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : 0;
+	if ((i < 1) || (i > p->block->count))
+		lua_pushnil(L);
+	else
+		svmLuaPush(L, p->block, i - 1);
+	return 1;
+}
+
+static int svmLuaNewIndex(lua_State *L) {
+	svmProxy *p = luaL_checkudata(L, 1, LUA_NAME_SSTRUCT);
+	vmStructField *f = svmLuaField(L, p, luaL_checkstring(L, 2));
+	if (f == NULL) luaL_error(L, "no field '%s' in struct %s", lua_tostring(L, 2), p->block->def->name);
+	if (!svmWrite(p->block->data + p->index * p->block->def->size + f->offset, f->type, luaL_checknumber(L, 3)))
+		luaL_error(L, "struct integer fields can not hold NaN or infinity");
+	return 0;
+}
+
+static int svmLuaLen(lua_State *L) {
+	svmProxy *p = luaL_checkudata(L, 1, LUA_NAME_SSTRUCT);
+	lua_pushinteger(L, p->block->count);
+	return 1;
+}
+
+static int svmLuaGC(lua_State *L) {
+	svmRelease(((svmProxy*)luaL_checkudata(L, 1, LUA_NAME_SSTRUCT))->block);
+	return 0;
+}
+
+luaL_Reg svmLuaMeta[] = {
+	{ "__index", svmLuaIndex },
+	{ "__newindex", svmLuaNewIndex },
+	{ "__len", svmLuaLen },
+	{ "__gc", svmLuaGC },
+	{ NULL, NULL }
+};
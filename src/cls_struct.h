@@ -0,0 +1,17 @@
+/*
+	cls_struct.h
+
+	wren running under lua 5.1+
+	implementation of structs defined from lua with carrica.defineStruct()
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "vm.h"
+void svmRelease(vmStructBlock *block);
+void svmLuaPush(lua_State *L, vmStructBlock *block, int index);
+bool svmLuaIsImported(carricaVM *cvm, int idx);
+void svmLuaToSlot(carricaVM *cvm, int slot, int idx);
+int svmLuaDefine(lua_State *L);
+extern luaL_Reg svmLuaMeta[];
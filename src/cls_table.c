@@ -20,6 +20,14 @@ vmWrenReference* tvmLuaNewTable(carricaVM *cvm) {
 	ret->type = VM_WREN_SHARE_TABLE;
 	ret->refCount = 1;
 	ret->cvm = cvm;
+	ret->handle = NULL;
+	ret->count = 0;
+	ret->epoch = 0;
+	ret->exposed = false;
+	ret->shared = NULL;
+	ret->journal = NULL;
+	ret->indexed = false;
+	ret->cursors = false;
 	lua_pushlightuserdata(L, ret);
 	lua_newtable(L);
 	lua_settable(L, LUA_REGISTRYINDEX);
@@ -34,6 +42,42 @@ vmWrenReference* tvmLuaNewTable(carricaVM *cvm) {
 	return ret;
 }
 
+// ********************************************************************************
+// element count upkeep
+
+// the kept count is exact unless lua holds the raw table and has run since we
+// last verified it, in which case it has to be counted again
+static bool tvmCountValid(vmWrenReference *ref) {
+	return !ref->exposed || (ref->epoch == ref->cvm->luaEpoch);
+}
+
+// recount the table at stack index t
+static void tvmRecount(vmWrenReference *ref, lua_State *L, int t) {
+	int cnt = 0;
+	lua_pushnil(L);
+	while (lua_next(L, t) != 0) {
+		cnt++;
+		lua_pop(L, 1);
+	}
+	ref->count = cnt;
+	ref->epoch = ref->cvm->luaEpoch;
+}
+
+// t[key] = value for the key and value on top of the stack (both popped),
+// following nil <-> non-nil transitions in the kept count (and the journal),
+// t is absolute
+static void tvmRawSetCounted(vmWrenReference *ref, lua_State *L, int t) {
+	if (ref->journal) vmJournalKey(ref, lua_isnil(L, -1) ? VM_JOURNAL_REMOVE : VM_JOURNAL_SET, L, -2);
+	lua_pushvalue(L, -2);
+	lua_rawget(L, t);
+	bool was = !lua_isnil(L, -1);
+	bool is = !lua_isnil(L, -2);
+	lua_pop(L, 1);
+	lua_rawset(L, t);
+	if (is && !was) ref->count++;
+	else if (was && !is) ref->count--;
+}
+
 // ********************************************************************************
 // functions
 
@@ -70,19 +114,21 @@ void tvmSet(WrenVM* vm) {
 	const char *str;
 	int len;
 	carricaVM *cvm = wrenGetUserData(vm);
+	vmRefOwn(ref);
 	lua_pushlightuserdata(cvm->L, ref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	int t = lua_gettop(cvm->L);
 	switch (wrenGetSlotType(vm, 1)) {
 		case WREN_TYPE_STRING:
 			str = wrenGetSlotBytes(cvm->vm, 1, &len);
 			lua_pushlstring(cvm->L, str, len);
 			luaPushFromWrenSlot(cvm, 2);
-			lua_settable(cvm->L, -3);
+			tvmRawSetCounted(ref, cvm->L, t);
 			break;
 		case WREN_TYPE_NUM:
 			lua_pushnumber(cvm->L, wrenGetSlotDouble(vm, 1));
 			luaPushFromWrenSlot(cvm, 2);
-			lua_settable(cvm->L, -3);
+			tvmRawSetCounted(ref, cvm->L, t);
 			break;
 		default:
 			wrenError(vm, "bad key passed to Table.set() numbers and strings only");
@@ -94,9 +140,14 @@ void tvmSet(WrenVM* vm) {
 void tvmClear(WrenVM* vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
+	vmRefDrop(reref->pref);
+	vmJournalReset(reref->pref);
 	lua_pushlightuserdata(cvm->L, reref->pref);
 	lua_newtable(cvm->L);
 	lua_settable(cvm->L, LUA_REGISTRYINDEX);
+	// lua never saw this new table, so the count is exact again
+	reref->pref->count = 0;
+	reref->pref->exposed = false;
 }
 
 void tvmContainsKey(WrenVM* vm) {
@@ -129,50 +180,53 @@ void tvmContainsKey(WrenVM* vm) {
 void tvmCount(WrenVM* vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
-	double cnt = 0;
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-    lua_pushnil(cvm->L);
-    while (lua_next(cvm->L, -2) != 0) {
-    	cnt++;
-       	lua_pop(cvm->L, 1);
-    }
-    lua_pop(cvm->L, 2);
-	wrenSetSlotDouble(vm, 0, cnt);
+	if (!tvmCountValid(reref->pref)) {
+		lua_pushlightuserdata(cvm->L, reref->pref);
+		lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+		tvmRecount(reref->pref, cvm->L, lua_gettop(cvm->L));
+		lua_pop(cvm->L, 1);
+	}
+	wrenSetSlotDouble(vm, 0, reref->pref->count);
 }
 
-void tvmKeys(WrenVM* vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	wrenEnsureSlots(vm, 2);
-	wrenSetSlotNewList(vm, 0);
-	lua_pushnil(cvm->L);
-    while (lua_next(cvm->L, -2) != 0) {
-    	wrenSetSlotFromLua(cvm, 1, -2);
-    	wrenInsertInList(vm, 0, -1, 1);
-       	lua_pop(cvm->L, 1);
-    }
-    lua_pop(cvm->L, 2);
-}
+// what tvmToList() pulls out of each pair
+#define TVM_LIST_KEYS		1
+#define TVM_LIST_VALUES		2
+#define TVM_LIST_BOTH		3
 
-void tvmValues(WrenVM* vm) {
+// build a Wren list in slot 0 from the table, a chunk of slots at a time
+static void tvmToList(WrenVM *vm, int mode) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	vmWrenReference *ref = reref->pref;
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
+	int per = (mode == TVM_LIST_BOTH) ? 2 : 1;
+	lua_pushlightuserdata(cvm->L, ref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	wrenEnsureSlots(vm, 2);
+	wrenEnsureSlots(vm, VM_LIST_CHUNK + 1);
 	wrenSetSlotNewList(vm, 0);
+	// when the kept count is good the list is sized once up front
+	if (tvmCountValid(ref)) wrenReserveList(vm, 0, ref->count * per);
+	int pos = 0;
+	int n = 0;
 	lua_pushnil(cvm->L);
-    while (lua_next(cvm->L, -2) != 0) {
-    	wrenSetSlotFromLua(cvm, 1, -1);
-    	wrenInsertInList(vm, 0, -1, 1);
-       	lua_pop(cvm->L, 1);
-    }
-    lua_pop(cvm->L, 2);
+	while (lua_next(cvm->L, -2) != 0) {
+		if (mode & TVM_LIST_KEYS) wrenSetSlotFromLua(cvm, ++n, -2);
+		if (mode & TVM_LIST_VALUES) wrenSetSlotFromLua(cvm, ++n, -1);
+		lua_pop(cvm->L, 1);
+		if (n + per > VM_LIST_CHUNK) {
+			wrenSetListElements(vm, 0, pos, n, 1);
+			pos += n;
+			n = 0;
+		}
+	}
+	wrenSetListElements(vm, 0, pos, n, 1);
+	lua_pop(cvm->L, 1);
 }
 
+void tvmKeys(WrenVM* vm) { tvmToList(vm, TVM_LIST_KEYS); }
+
+void tvmValues(WrenVM* vm) { tvmToList(vm, TVM_LIST_VALUES); }
+
 // create and return a new Table
 void tvmAllocate(WrenVM* vm) {
 	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 0, VM_REREF_SIZE);
@@ -186,6 +240,8 @@ void tvmFinalize(void *obj) {
 	vmWrenReReference* ref = obj;
 	// we do nothing but deincrement reference count, and let lua side handle cleanup
 	if (ref->pref->refCount > 0) ref->pref->refCount--;
+	// lua never sees the reference of a Wren made Table, so it's share can go now
+	if ((ref->pref->refCount == 0) && (ref->pref->handle == NULL)) vmRefDrop(ref->pref);
 }
 
 void tvmHold(WrenVM *vm) {
@@ -198,27 +254,80 @@ void tvmRelease(WrenVM *vm) {
 	if (reref->pref->refCount > 0) reref->pref->refCount--;
 }
 
+// copy the entries of the Wren Map in slot map into the table at stack index t
+// (absolute) using the two slots after map, without calling back into Wren, an
+// empty table lua hasn't seen is swapped for one sized to fit the Map first
+static void tvmInsertMap(WrenVM *vm, carricaVM *cvm, vmWrenReference *ref, int t, int map) {
+	lua_State *L = cvm->L;
+	int cnt = wrenGetMapCount(vm, map);
+	int cap = wrenGetMapCapacity(vm, map);
+	if ((ref->count == 0) && !ref->exposed && (cnt > 0)) {
+		lua_createtable(L, 0, cnt);
+		lua_pushlightuserdata(L, ref);
+		lua_pushvalue(L, -2);
+		lua_settable(L, LUA_REGISTRYINDEX);
+		lua_replace(L, t);
+	}
+	wrenEnsureSlots(vm, map + 3);
+	for (int i = 0; i < cap; i++) {
+		if (!wrenGetMapEntry(vm, map, i, map + 1, map + 2)) continue;
+		WrenType kt = wrenGetSlotType(vm, map + 1);
+		double n = (kt == WREN_TYPE_NUM) ? wrenGetSlotDouble(vm, map + 1) : 0;
+		// lua won't take a NaN key either
+		if (((kt != WREN_TYPE_STRING) && (kt != WREN_TYPE_NUM)) || (n != n))
+			WERR("bad key in Map passed to Table, numbers and strings only")
+		luaPushFromWrenSlot(cvm, map + 1);
+		luaPushFromWrenSlot(cvm, map + 2);
+		tvmRawSetCounted(ref, L, t);
+	}
+}
+
+// the body of Table.fromMap(), a new Table sized for the Map up front
+void tvmFromMap(WrenVM *vm) {
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_MAP) WERR("bad value passed to Table.fromMap() map only")
+	wrenEnsureSlots(vm, 4);
+	if (cvm->handle.Table == NULL) cvm->handle.Table = lcvmGetClassHandle(cvm, "carrica", "Table");
+	wrenSetSlotHandle(vm, 2, cvm->handle.Table);
+	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 2, VM_REREF_SIZE);
+	ref->type = VM_WREN_SHARE_TABLE;
+	ref->pref = tvmLuaNewTable(cvm);
+	ref->cvm = cvm;
+	lua_pushlightuserdata(cvm->L, ref->pref);
+	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	tvmInsertMap(vm, cvm, ref->pref, lua_gettop(cvm->L), 1);
+	lua_pop(cvm->L, 1);
+}
+
 void tvmInsertAll(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	vmWrenReference *ref = reref->pref;
 	vmWrenReReference *tref = NULL;
 	int end = 0;
 	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
+	vmRefOwn(ref);
+	lua_pushlightuserdata(cvm->L, ref);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
+	int t = lua_gettop(cvm->L);
 	switch (wrenGetSlotType(vm, 1)) {
+		case WREN_TYPE_MAP:
+			tvmInsertMap(vm, cvm, ref, t, 1);
+			break;
 		case WREN_TYPE_LIST:
 			// a passed in list must be [ key, value, key, value, ... ]
 			end = wrenGetListCount(vm, 1);
 			if (end % 2) {
 				wrenError(vm, "bad List passed to Table.insertAll(), unmatched key-value pair");
 			} else {
-				wrenEnsureSlots(vm, 4);
-				for (int i = 0; i < end; i = i + 2) {
-					wrenGetListElement(vm, 1, i, 2);
-					wrenGetListElement(vm, 1, i + 1, 3);
-					luaPushFromWrenSlot(cvm, 2);
-					luaPushFromWrenSlot(cvm, 3);
-					lua_settable(cvm->L, -3);
+				wrenEnsureSlots(vm, VM_LIST_CHUNK + 2);
+				for (int i = 0; i < end; i += VM_LIST_CHUNK) {
+					int n = (end - i < VM_LIST_CHUNK) ? end - i : VM_LIST_CHUNK;
+					wrenGetListElements(vm, 1, i, n, 2);
+					for (int j = 0; j < n; j = j + 2) {
+						luaPushFromWrenSlot(cvm, j + 2);
+						luaPushFromWrenSlot(cvm, j + 3);
+						tvmRawSetCounted(ref, cvm->L, t);
+					}
 				}
 			}
 			break;
@@ -228,24 +337,23 @@ void tvmInsertAll(WrenVM *vm) {
 				lua_pushlightuserdata(cvm->L, tref->pref);
 				lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 				lua_pushnil(cvm->L);
-				while (lua_next(cvm->L, -2) != 0) {
-					lua_settable(cvm->L, -4);
-					lua_pop(cvm->L, 1);
+				while (lua_next(cvm->L, t + 1) != 0) {
+					// keep the key for lua_next(), copy the pair over
+					lua_pushvalue(cvm->L, -2);
+					lua_insert(cvm->L, -2);
+					tvmRawSetCounted(ref, cvm->L, t);
 				}
-				lua_pop(cvm->L, 2);
-				return;
+				lua_pop(cvm->L, 1);
 			} else if (tref->type == VM_WREN_SHARE_ARRAY) {
 				// a passed array must be [ key, value, key, value, ... ]
-				lua_pushlightuserdata(cvm->L, tref->pref);
-				lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-				end = lua_objlen(cvm->L, -1);
-				for (int i = 1; i <= end; i = i + 2) {
-					lua_rawgeti(cvm->L, -1, i);
-					lua_rawgeti(cvm->L, -1, i + 1);
-					lua_settable(cvm->L, -4);
+				int base;
+				end = avmPushTable(cvm, tref, &base);
+				for (int i = 1; i < end; i = i + 2) {
+					lua_rawgeti(cvm->L, t + 1, base + i);
+					lua_rawgeti(cvm->L, t + 1, base + i + 1);
+					tvmRawSetCounted(ref, cvm->L, t);
 				}
-				lua_pop(cvm->L, 2);
-				return;
+				lua_pop(cvm->L, 1);
 			} else 
 				wrenError(vm, "bad foreign class passed to Table.insertAll()");
 			break;
@@ -255,6 +363,21 @@ void tvmInsertAll(WrenVM *vm) {
 	lua_pop(cvm->L, 1);
 }
 
+// the body of Table.copy(), another Table that lua can't write to behind our
+// back is shared until one side writes, anything else is copied now
+void tvmCopy(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
+	if (wrenGetSlotType(vm, 1) == WREN_TYPE_FOREIGN) {
+		vmWrenReReference *other = wrenGetSlotForeign(vm, 1);
+		if ((other->type == VM_WREN_SHARE_TABLE) && !other->pref->exposed
+			&& (other->cvm == reref->cvm)) {
+			vmRefShare(reref->pref, other->pref);
+			return;
+		}
+	}
+	tvmInsertAll(vm);
+}
+
 void tvmArray(WrenVM *vm) {
 	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
@@ -278,129 +401,67 @@ void tvmArray(WrenVM *vm) {
     lua_pop(cvm->L, 2);
 }
 
-void tvmList(WrenVM *vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	wrenEnsureSlots(vm, 2);
-	wrenSetSlotNewList(vm, 0);
-	lua_pushnil(cvm->L);
-    while (lua_next(cvm->L, -2) != 0) {
-    	wrenSetSlotFromLua(cvm, 1, -2);
-    	wrenInsertInList(vm, 0, -1, 1);
-    	wrenSetSlotFromLua(cvm, 1, -1);
-    	wrenInsertInList(vm, 0, -1, 1);
-       	lua_pop(cvm->L, 1);
-    }
-    lua_pop(cvm->L, 2);
-}
-
-void tvmIterate(WrenVM *vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	if (wrenGetSlotType(vm, 1) == WREN_TYPE_NULL) {
-		lua_pushnil(cvm->L);
-		if (lua_next(cvm->L, -2) != 0) {
-			wrenSetSlotBool(vm, 0, true);
-			// store this key for the next call
-			lua_pushlightuserdata(cvm->L, reref);
-			lua_pushvalue(cvm->L, -3);
-			lua_settable(cvm->L, LUA_REGISTRYINDEX);
-		} else {
-			wrenSetSlotBool(vm, 0, false);
-			lua_pop(cvm->L, 2);
-			return;
-		}
-	} else {
-		// pull the last key out of the registry
-		lua_pushlightuserdata(cvm->L, reref);
-		lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-		if (lua_next(cvm->L, -2) != 0) {
-			wrenSetSlotBool(vm, 0, true);
-			// store this key for the next call
-			lua_pushlightuserdata(cvm->L, reref);
-			lua_pushvalue(cvm->L, -3);
-			lua_settable(cvm->L, LUA_REGISTRYINDEX);
-		} else {
-			wrenSetSlotBool(vm, 0, false);
-			lua_pop(cvm->L, 2);
-			return;
-		}
-	}
-	lua_pop(cvm->L, 3);
-}
-
-void tvmIteratorValue(WrenVM *vm) {
-	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_pushlightuserdata(cvm->L, reref->pref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	// get the stored key
-	lua_pushlightuserdata(cvm->L, reref);
-	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
-	lua_pushvalue(cvm->L, -1);
-	// pull the value from our table
-	lua_gettable(cvm->L, -3);
-	// key is at -2, and value is at -1 with the table at -3
-	wrenEnsureSlots(vm, 2);
-	if (cvm->handle.TableEntry == NULL) cvm->handle.TableEntry = lcvmGetClassHandle(cvm, "carrica", "TableEntry");
-	wrenSetSlotHandle(vm, 1, cvm->handle.TableEntry);
-	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 1, VM_REREF_SIZE);
-	ref->type = VM_WREN_SHARE_TABLE_ENTRY;
-	ref->pref = NULL;
-	ref->cvm = cvm;
-	lua_pushlightuserdata(cvm->L, &ref->pref);
-	lua_pushvalue(cvm->L, -2);
-	lua_settable(cvm->L, LUA_REGISTRYINDEX);
-	lua_pop(cvm->L, 1);
-	lua_pushlightuserdata(cvm->L, &ref->type);
-	lua_pushvalue(cvm->L, -2);
-	lua_settable(cvm->L, LUA_REGISTRYINDEX);
-	lua_pop(cvm->L, 2);
-}
-
-// create and return a new Table
-void tevmAllocate(WrenVM* vm) {
-	vmWrenReReference* ref = wrenSetSlotNewForeign(vm, 0, 0, VM_REREF_SIZE);
-	ref->type = VM_WREN_SHARE_TABLE_ENTRY;
-	ref->pref = NULL;
-	ref->cvm = wrenGetUserData(vm);
-}
-
-// remove a table
-void tevmFinalize(void *obj) {
-	vmWrenReReference* ref = obj;
-	// remove the stored lua objects
-	lua_State *L = ref->cvm->L;
-	lua_pushlightuserdata(L, &ref->type);
-	lua_pushnil(L);
-	lua_settable(L, LUA_REGISTRYINDEX);
-	lua_pushlightuserdata(L, &ref->pref);
-	lua_pushnil(L);
-	lua_settable(L, LUA_REGISTRYINDEX);
-}
+void tvmList(WrenVM *vm) { tvmToList(vm, TVM_LIST_BOTH); }
 
-void tevmKey(WrenVM *vm) {
-	vmWrenReReference *ref = wrenGetSlotForeign(vm, 0);
-	carricaVM *cvm = wrenGetUserData(vm);
-	lua_State *L = cvm->L;
-	lua_pushlightuserdata(L, &ref->type);
-	lua_gettable(L, LUA_REGISTRYINDEX);
-	wrenSetSlotFromLua(cvm, 0, -1);
+// the registry table of the lua keys where each walk of ref is, made when the
+// first walk starts
+static void tvmPushCursors(vmWrenReference *ref, lua_State *L) {
+	lua_pushlightuserdata(L, &ref->cursors);
+	lua_rawget(L, LUA_REGISTRYINDEX);
+	if (!lua_isnil(L, -1)) return;
 	lua_pop(L, 1);
+	lua_newtable(L);
+	lua_pushlightuserdata(L, &ref->cursors);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	ref->cursors = true;
 }
 
-void tevmValue(WrenVM *vm) {
-	vmWrenReReference *ref = wrenGetSlotForeign(vm, 0);
+// step a lua_next() cursor held in a Wren list [key, value, walking], the list
+// is updated in place so walking a Table allocates nothing per element. The
+// lua key stays on the lua side, by the identity of the list, as a key Wren
+// can't hold (a function, say) would not come back as the same lua value
+void tvmNext(WrenVM *vm) {
+	vmWrenReReference *reref = wrenGetSlotForeign(vm, 0);
 	carricaVM *cvm = wrenGetUserData(vm);
 	lua_State *L = cvm->L;
-	lua_pushlightuserdata(L, &ref->pref);
+	if ((wrenGetSlotType(vm, 1) != WREN_TYPE_LIST) || (wrenGetListCount(vm, 1) < 3))
+		WERR("bad cursor passed to Table.next_(), [key, value, walking] list expected")
+	wrenEnsureSlots(vm, 3);
+	void *id = (void*)wrenGetSlotIdentity(vm, 1);
+	lua_pushlightuserdata(L, reref->pref);
 	lua_gettable(L, LUA_REGISTRYINDEX);
-	wrenSetSlotFromLua(cvm, 0, -1);
-	lua_pop(L, 1);
+	tvmPushCursors(reref->pref, L);
+	// a cursor that isn't walking yet starts from the top
+	wrenGetListElement(vm, 1, 2, 2);
+	if ((wrenGetSlotType(vm, 2) == WREN_TYPE_BOOL) && wrenGetSlotBool(vm, 2)) {
+		lua_pushlightuserdata(L, id);
+		lua_rawget(L, -2);
+	} else
+		lua_pushnil(L);
+	if (lua_next(L, -3) != 0) {
+		// key is at -2 and value at -1, with the cursors at -3 and the table at -4
+		lua_pushlightuserdata(L, id);
+		lua_pushvalue(L, -3);
+		lua_rawset(L, -5);
+		wrenSetSlotFromLua(cvm, 2, -2);
+		wrenSetListElement(vm, 1, 0, 2);
+		wrenSetSlotFromLua(cvm, 2, -1);
+		wrenSetListElement(vm, 1, 1, 2);
+		wrenSetSlotBool(vm, 2, true);
+		wrenSetListElement(vm, 1, 2, 2);
+		wrenSetSlotBool(vm, 0, true);
+		lua_pop(L, 4);
+	} else {
+		// done, the list can start another walk
+		lua_pushlightuserdata(L, id);
+		lua_pushnil(L);
+		lua_rawset(L, -3);
+		wrenSetSlotBool(vm, 2, false);
+		wrenSetListElement(vm, 1, 2, 2);
+		wrenSetSlotBool(vm, 0, false);
+		lua_pop(L, 2);
+	}
 }
 
 // ********************************************************************************
@@ -416,30 +477,23 @@ const vmForeignMethodDef _t_func[] = {
 	{ false, "values", tvmValues },
 	{ false, "hold()", tvmHold },
 	{ false, "release()", tvmRelease },	
-	{ false, "finsertAll(_)", tvmInsertAll },
+	{ true, "fromMap(_)", tvmFromMap },
+	{ false, "insertAll(_)", tvmInsertAll },
+	{ false, "fcopy(_)", tvmCopy },
 	{ false, "array", tvmArray },
 	{ false, "list", tvmList },
-	{ false, "iterate(_)", tvmIterate },
-	{ false, "iteratorValue(_)", tvmIteratorValue },	
-	{ false, NULL, NULL }
-};
-
-const vmForeignMethodDef _te_func[] = {
-	{ false, "key", tevmKey },
-	{ false, "value", tevmValue },
+	{ false, "next_(_)", tvmNext },
 	{ false, NULL, NULL }
 };
 
 // class methods in this module
 const vmForeignMethodTable _t_mtab[] = { 
 	{ "Table", _t_func }, 
-	{ "TableEntry", _te_func }, 
 	{ NULL, NULL } };
 
 // foreign classes in this module
 const vmForeignClassDef _t_cdef[] = { 
 	{ "Table", { tvmAllocate, tvmFinalize } },
-	{ "TableEntry", { tevmAllocate, tevmFinalize } },
 	{ NULL, { NULL, NULL } } };
 const vmForeignClassTable _t_ctab[] = { { _t_cdef } };
 
@@ -0,0 +1,490 @@
+/*
+	cls_typed.c
+
+	wren running under lua 5.1+
+	implementation of Float64Array and Int32Array classes
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "cls_typed.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WERR(x) { wrenError(vm, x); return; }
+
+// a double that isn't NaN as an int32_t, truncated toward zero and held to the
+// ends of the range, a plain cast of anything outside it is undefined
+static inline int32_t tyvmToI32(double v) {
+	return (v <= INT32_MIN) ? INT32_MIN : ((v >= INT32_MAX) ? INT32_MAX : (int32_t)v);
+}
+#define TYVM_TO_F64(v) (v)
+#define TYVM_TO_I32(v) tyvmToI32(v)
+
+// the kernels below are plain loops written so the compiler can vectorize
+// them (SSE2 is the x86-64 baseline), where the toolchain can do it we also
+// build an AVX2 copy and let the loader pick one for the CPU we run on
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+	#define TYVM_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+	#define TYVM_KERNEL
+#endif
+
+// ********************************************************************************
+// kernels, one set per element type
+
+// TO converts a finite double to T, the callers keep NaN out of them
+#define TYVM_KERNELS(S, T, TO) \
+TYVM_KERNEL static double tyvmSum##S(const T *p, int n) { \
+	double a0 = 0, a1 = 0, a2 = 0, a3 = 0; \
+	int i = 0; \
+	for (; i + 4 <= n; i += 4) { \
+		a0 += p[i]; a1 += p[i + 1]; a2 += p[i + 2]; a3 += p[i + 3]; \
+	} \
+	for (; i < n; i++) a0 += p[i]; \
+	return (a0 + a1) + (a2 + a3); \
+} \
+TYVM_KERNEL static T tyvmMin##S(const T *p, int n) { \
+	T m = p[0]; \
+	for (int i = 1; i < n; i++) m = (p[i] < m) ? p[i] : m; \
+	return m; \
+} \
+TYVM_KERNEL static T tyvmMax##S(const T *p, int n) { \
+	T m = p[0]; \
+	for (int i = 1; i < n; i++) m = (p[i] > m) ? p[i] : m; \
+	return m; \
+} \
+TYVM_KERNEL static double tyvmDot##S(const T *a, const T *b, int n) { \
+	double a0 = 0, a1 = 0, a2 = 0, a3 = 0; \
+	int i = 0; \
+	for (; i + 4 <= n; i += 4) { \
+		a0 += (double)a[i] * b[i]; a1 += (double)a[i + 1] * b[i + 1]; \
+		a2 += (double)a[i + 2] * b[i + 2]; a3 += (double)a[i + 3] * b[i + 3]; \
+	} \
+	for (; i < n; i++) a0 += (double)a[i] * b[i]; \
+	return (a0 + a1) + (a2 + a3); \
+} \
+TYVM_KERNEL static void tyvmAxpy##S(T *restrict y, const T *restrict x, double a, int n) { \
+	for (int i = 0; i < n; i++) y[i] = TO(y[i] + a * x[i]); \
+} \
+TYVM_KERNEL static void tyvmScale##S(T *p, double a, int n) { \
+	for (int i = 0; i < n; i++) p[i] = TO(p[i] * a); \
+} \
+TYVM_KERNEL static void tyvmFill##S(T *p, T v, int n) { \
+	for (int i = 0; i < n; i++) p[i] = v; \
+} \
+TYVM_KERNEL static void tyvmClamp##S(T *p, T lo, T hi, int n) { \
+	for (int i = 0; i < n; i++) { \
+		T v = p[i]; \
+		v = (v < lo) ? lo : v; \
+		p[i] = (v > hi) ? hi : v; \
+	} \
+} \
+static void tyvmPrefix##S(T *p, int n) { \
+	double sum = 0; \
+	for (int i = 0; i < n; i++) { \
+		sum += p[i]; \
+		p[i] = TO(sum); \
+	} \
+} \
+TYVM_KERNEL static void tyvmMask##S(const T *restrict p, double x, int32_t *restrict out, int n) { \
+	for (int i = 0; i < n; i++) out[i] = p[i] > x; \
+}
+
+TYVM_KERNELS(F64, double, TYVM_TO_F64)
+TYVM_KERNELS(I32, int32_t, TYVM_TO_I32)
+
+// ********************************************************************************
+// storage
+
+// NULL when there isn't the memory for it
+static vmTypedArray* tyvmNew(int elemType, int count) {
+	vmTypedArray *arr = calloc(1, sizeof(vmTypedArray));
+	if (arr == NULL) return NULL;
+	arr->refCount = 1;
+	arr->elemType = elemType;
+	arr->count = count;
+	arr->data = calloc(count ? count : 1, (elemType == VM_TYPED_F64) ? sizeof(double) : sizeof(int32_t));
+	if (arr->data == NULL) {
+		free(arr);
+		return NULL;
+	}
+	return arr;
+}
+
+// drop a reference, the storage goes when Wren and every lua proxy let go
+void tyvmRelease(vmTypedArray *arr) {
+	if (--arr->refCount > 0) return;
+	free(arr->data);
+	free(arr);
+}
+
+static double tyvmGetAt(vmTypedArray *arr, int i) {
+	if (arr->elemType == VM_TYPED_F64) return ((double*)arr->data)[i];
+	return ((int32_t*)arr->data)[i];
+}
+
+// false for NaN going into an Int32Array, which has nothing to store it as
+static bool tyvmSetAt(vmTypedArray *arr, int i, double v) {
+	if (arr->elemType == VM_TYPED_F64)
+		((double*)arr->data)[i] = v;
+	else if (isnan(v))
+		return false;
+	else
+		((int32_t*)arr->data)[i] = tyvmToI32(v);
+	return true;
+}
+
+// the element index in slot, counting back from the end when negative, or -1
+// when it's not a number inside the array
+static int tyvmIndex(WrenVM *vm, int slot, int count) {
+	if (wrenGetSlotType(vm, slot) != WREN_TYPE_NUM) return -1;
+	double i = wrenGetSlotDouble(vm, slot);
+	if (i < 0) i += count;
+	return ((i >= 0) && (i < count)) ? (int)i : -1;
+}
+
+static vmTypedArray* tyvmSelf(WrenVM *vm) {
+	return ((vmWrenTyped*)wrenGetSlotForeign(vm, 0))->arr;
+}
+
+// the typed array in slot, if it holds one of the same element type as arr
+static vmTypedArray* tyvmOther(WrenVM *vm, int slot, vmTypedArray *arr) {
+	if (wrenGetSlotType(vm, slot) != WREN_TYPE_FOREIGN) return NULL;
+	vmWrenTyped *w = wrenGetSlotForeign(vm, slot);
+	if ((w->type != VM_WREN_SHARE_TYPED) || (w->arr->elemType != arr->elemType)) return NULL;
+	return w->arr;
+}
+
+// make a typed array foreign for arr in slot, the class handle goes in classSlot
+static vmWrenTyped* tyvmWrap(carricaVM *cvm, int slot, int classSlot, int elemType) {
+	WrenHandle **h = (elemType == VM_TYPED_F64) ? &cvm->handle.Float64Array : &cvm->handle.Int32Array;
+	if (*h == NULL) *h = lcvmGetClassHandle(cvm, "carrica", (elemType == VM_TYPED_F64) ? "Float64Array" : "Int32Array");
+	wrenSetSlotHandle(cvm->vm, classSlot, *h);
+	vmWrenTyped *w = wrenSetSlotNewForeign(cvm->vm, slot, classSlot, VM_WTYPED_SIZE);
+	w->type = VM_WREN_SHARE_TYPED;
+	w->cvm = cvm;
+	return w;
+}
+
+// make a new typed array foreign in slot 0, the class handle goes in classSlot,
+// NULL (and no foreign) when there isn't the memory for it
+static vmTypedArray* tyvmNewInSlot(WrenVM *vm, int classSlot, int elemType, int count) {
+	vmTypedArray *arr = tyvmNew(elemType, count);
+	if (arr == NULL) return NULL;
+	tyvmWrap(wrenGetUserData(vm), 0, classSlot, elemType)->arr = arr;
+	return arr;
+}
+
+// ********************************************************************************
+// functions
+
+void tyvmGet(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	int i = tyvmIndex(vm, 1, arr->count);
+	if (i < 0) WERR("index out of bounds on typed array []")
+	wrenSetSlotDouble(vm, 0, tyvmGetAt(arr, i));
+}
+
+void tyvmSet(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	int i = tyvmIndex(vm, 1, arr->count);
+	if (i < 0) WERR("index out of bounds on typed array []=")
+	if (wrenGetSlotType(vm, 2) != WREN_TYPE_NUM) WERR("typed arrays only hold numbers")
+	if (!tyvmSetAt(arr, i, wrenGetSlotDouble(vm, 2))) WERR("an Int32Array can not hold NaN")
+}
+
+void tyvmCount(WrenVM *vm) {
+	wrenSetSlotDouble(vm, 0, tyvmSelf(vm)->count);
+}
+
+// copy n elements from start into the Wren list in slot list from index 0
+static void tyvmToList(WrenVM *vm, vmTypedArray *arr, int list, int start, int n) {
+	wrenEnsureSlots(vm, list + VM_LIST_CHUNK + 1);
+	for (int i = 0; i < n; i += VM_LIST_CHUNK) {
+		int c = (n - i < VM_LIST_CHUNK) ? n - i : VM_LIST_CHUNK;
+		for (int j = 0; j < c; j++) wrenSetSlotDouble(vm, list + 1 + j, tyvmGetAt(arr, start + i + j));
+		wrenSetListElements(vm, list, i, c, list + 1);
+	}
+}
+
+void tyvmList(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	wrenSetSlotNewList(vm, 0);
+	wrenReserveList(vm, 0, arr->count);
+	tyvmToList(vm, arr, 0, 0, arr->count);
+}
+
+// the same protocol Array uses, so ArrayCursor walks us too
+void tyvmChunk(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("bad parameters passed to chunk_(), list and number expected")
+	int start = (int)wrenGetSlotDouble(vm, 2);
+	int n = arr->count - start;
+	if (n > wrenGetListCount(vm, 1)) n = wrenGetListCount(vm, 1);
+	if (n < 0) n = 0;
+	tyvmToList(vm, arr, 1, start, n);
+	wrenSetSlotDouble(vm, 0, n);
+}
+
+static void tyvmFromList(WrenVM *vm, int elemType) {
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST) WERR("bad value passed to fromList() list only")
+	int cnt = wrenGetListCount(vm, 1);
+	wrenEnsureSlots(vm, VM_LIST_CHUNK + 3);
+	vmTypedArray *arr = tyvmNewInSlot(vm, 2, elemType, cnt);
+	if (arr == NULL) WERR("out of memory for a typed array")
+	for (int i = 0; i < cnt; i += VM_LIST_CHUNK) {
+		int n = (cnt - i < VM_LIST_CHUNK) ? cnt - i : VM_LIST_CHUNK;
+		wrenGetListElements(vm, 1, i, n, 3);
+		for (int j = 0; j < n; j++) {
+			if (wrenGetSlotType(vm, 3 + j) != WREN_TYPE_NUM) WERR("typed arrays only hold numbers")
+			if (!tyvmSetAt(arr, i + j, wrenGetSlotDouble(vm, 3 + j))) WERR("an Int32Array can not hold NaN")
+		}
+	}
+}
+void tyvmFromListF64(WrenVM *vm) { tyvmFromList(vm, VM_TYPED_F64); }
+void tyvmFromListI32(WrenVM *vm) { tyvmFromList(vm, VM_TYPED_I32); }
+
+void tyvmSum(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (arr->elemType == VM_TYPED_F64)
+		wrenSetSlotDouble(vm, 0, tyvmSumF64(arr->data, arr->count));
+	else
+		wrenSetSlotDouble(vm, 0, tyvmSumI32(arr->data, arr->count));
+}
+
+void tyvmMin(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (arr->count == 0) WERR("min called on an empty typed array")
+	if (arr->elemType == VM_TYPED_F64)
+		wrenSetSlotDouble(vm, 0, tyvmMinF64(arr->data, arr->count));
+	else
+		wrenSetSlotDouble(vm, 0, tyvmMinI32(arr->data, arr->count));
+}
+
+void tyvmMax(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (arr->count == 0) WERR("max called on an empty typed array")
+	if (arr->elemType == VM_TYPED_F64)
+		wrenSetSlotDouble(vm, 0, tyvmMaxF64(arr->data, arr->count));
+	else
+		wrenSetSlotDouble(vm, 0, tyvmMaxI32(arr->data, arr->count));
+}
+
+void tyvmDot(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	vmTypedArray *other = tyvmOther(vm, 1, arr);
+	if ((other == NULL) || (other->count != arr->count))
+		WERR("dot() needs a typed array of the same type and size")
+	if (arr->elemType == VM_TYPED_F64)
+		wrenSetSlotDouble(vm, 0, tyvmDotF64(arr->data, other->data, arr->count));
+	else
+		wrenSetSlotDouble(vm, 0, tyvmDotI32(arr->data, other->data, arr->count));
+}
+
+// this = this + a * x
+void tyvmAxpy(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	vmTypedArray *other = tyvmOther(vm, 2, arr);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("axpy() needs a number to scale by")
+	if ((other == NULL) || (other->count != arr->count))
+		WERR("axpy() needs a typed array of the same type and size")
+	if (other == arr) WERR("axpy() can not be passed the array it is called on")
+	double a = wrenGetSlotDouble(vm, 1);
+	if ((arr->elemType == VM_TYPED_I32) && !isfinite(a)) WERR("axpy() on an Int32Array needs a finite number")
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmAxpyF64(arr->data, other->data, a, arr->count);
+	else
+		tyvmAxpyI32(arr->data, other->data, a, arr->count);
+}
+
+void tyvmScale(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("scale() needs a number")
+	double a = wrenGetSlotDouble(vm, 1);
+	if ((arr->elemType == VM_TYPED_I32) && !isfinite(a)) WERR("scale() on an Int32Array needs a finite number")
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmScaleF64(arr->data, a, arr->count);
+	else
+		tyvmScaleI32(arr->data, a, arr->count);
+}
+
+void tyvmFill(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("fill() needs a number")
+	double v = wrenGetSlotDouble(vm, 1);
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmFillF64(arr->data, v, arr->count);
+	else if (isnan(v))
+		WERR("an Int32Array can not hold NaN")
+	else
+		tyvmFillI32(arr->data, tyvmToI32(v), arr->count);
+}
+
+void tyvmClamp(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("clamp() needs two numbers")
+	double lo = wrenGetSlotDouble(vm, 1);
+	double hi = wrenGetSlotDouble(vm, 2);
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmClampF64(arr->data, lo, hi, arr->count);
+	else if (isnan(lo) || isnan(hi))
+		WERR("clamp() on an Int32Array can not use NaN")
+	else
+		// the integers inside [lo, hi]
+		tyvmClampI32(arr->data, tyvmToI32(ceil(lo)), tyvmToI32(floor(hi)), arr->count);
+}
+
+void tyvmPrefixSum(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmPrefixF64(arr->data, arr->count);
+	else
+		tyvmPrefixI32(arr->data, arr->count);
+}
+
+// a new Int32Array holding 1 where we are above x, and 0 elsewhere
+void tyvmMask(WrenVM *vm) {
+	vmTypedArray *arr = tyvmSelf(vm);
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("mask() needs a number")
+	double x = wrenGetSlotDouble(vm, 1);
+	wrenEnsureSlots(vm, 3);
+	vmTypedArray *out = tyvmNewInSlot(vm, 2, VM_TYPED_I32, arr->count);
+	if (out == NULL) WERR("out of memory for a typed array")
+	if (arr->elemType == VM_TYPED_F64)
+		tyvmMaskF64(arr->data, x, out->data, arr->count);
+	else
+		tyvmMaskI32(arr->data, x, out->data, arr->count);
+}
+
+// construct new(size), the size comes in slot 1
+static void tyvmAllocate(WrenVM *vm, int elemType) {
+	double size = (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM) ? wrenGetSlotDouble(vm, 1) : 0;
+	if (size > INT_MAX) WERR("typed array size is too big")
+	vmTypedArray *arr = tyvmNew(elemType, (size >= 1) ? (int)size : 0);
+	if (arr == NULL) WERR("out of memory for a typed array")
+	vmWrenTyped *w = wrenSetSlotNewForeign(vm, 0, 0, VM_WTYPED_SIZE);
+	w->type = VM_WREN_SHARE_TYPED;
+	w->cvm = wrenGetUserData(vm);
+	w->arr = arr;
+}
+void tyvmAllocateF64(WrenVM *vm) { tyvmAllocate(vm, VM_TYPED_F64); }
+void tyvmAllocateI32(WrenVM *vm) { tyvmAllocate(vm, VM_TYPED_I32); }
+
+void tyvmFinalize(void *obj) {
+	vmWrenTyped *w = obj;
+	tyvmRelease(w->arr);
+}
+
+// ********************************************************************************
+// the lua side proxy, a userdata holding a reference to the storage, t.ptr is
+// the raw memory for the ffi, as in ffi.cast(t.ctype .. '*', t.ptr)
+
+void tyvmLuaPush(lua_State *L, vmTypedArray *arr) {
+	vmTypedArray **p = lua_newuserdata(L, sizeof(vmTypedArray*));
+	*p = arr;
+	arr->refCount++;
+	luaL_getmetatable(L, LUA_NAME_STYPED);
+	lua_setmetatable(L, -2);
+}
+
+// a proxy lua hands back becomes a new Wren typed array sharing the same storage
+void tyvmLuaToSlot(carricaVM *cvm, int slot, int idx) {
+	vmTypedArray *arr = *(vmTypedArray**)lua_touserdata(cvm->L, idx);
+	vmWrenTyped *w = tyvmWrap(cvm, slot, slot, arr->elemType);
+	w->arr = arr;
+	arr->refCount++;
+}
+
+static int tyvmLuaIndex(lua_State *L) {
+	vmTypedArray *arr = *(vmTypedArray**)luaL_checkudata(L, 1, LUA_NAME_STYPED);
+	if (lua_type(L, 2) == LUA_TSTRING) {
+		const char *k = lua_tostring(L, 2);
+		if (!strcmp(k, "ptr"))
+			lua_pushlightuserdata(L, arr->data);
+		else if (!strcmp(k, "ctype"))
+			lua_pushstring(L, (arr->elemType == VM_TYPED_F64) ? "double" : "int32_t");
+		else
+			lua_pushnil(L);
+		return 1;
+	}
+	int i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : 0;
+	if ((i < 1) || (i > arr->count))
+		lua_pushnil(L);
+	else
+		lua_pushnumber(L, tyvmGetAt(arr, i - 1));
+	return 1;
+}
+
+static int tyvmLuaNewIndex(lua_State *L) {
+	vmTypedArray *arr = *(vmTypedArray**)luaL_checkudata(L, 1, LUA_NAME_STYPED);
+	int i = luaL_checkint(L, 2);
+	if ((i < 1) || (i > arr->count)) luaL_error(L, "index out of bounds on typed array");
+	if (!tyvmSetAt(arr, i - 1, luaL_checknumber(L, 3))) luaL_error(L, "an Int32Array can not hold NaN");
+	return 0;
+}
+
+static int tyvmLuaLen(lua_State *L) {
+	vmTypedArray *arr = *(vmTypedArray**)luaL_checkudata(L, 1, LUA_NAME_STYPED);
+	lua_pushinteger(L, arr->count);
+	return 1;
+}
+
+static int tyvmLuaGC(lua_State *L) {
+	tyvmRelease(*(vmTypedArray**)luaL_checkudata(L, 1, LUA_NAME_STYPED));
+	return 0;
+}
+
+luaL_Reg tyvmLuaMeta[] = {
+	{ "__index", tyvmLuaIndex },
+	{ "__newindex", tyvmLuaNewIndex },
+	{ "__len", tyvmLuaLen },
+	{ "__gc", tyvmLuaGC },
+	{ NULL, NULL }
+};
+
+// ********************************************************************************
+// wrap it all up for Wren
+
+#define TYVM_METHODS(fromList) \
+	{ false, "[_]", tyvmGet }, \
+	{ false, "[_]=(_)", tyvmSet }, \
+	{ true, "fromList(_)", fromList }, \
+	{ false, "count", tyvmCount }, \
+	{ false, "list", tyvmList }, \
+	{ false, "chunk_(_,_)", tyvmChunk }, \
+	{ false, "sum", tyvmSum }, \
+	{ false, "min", tyvmMin }, \
+	{ false, "max", tyvmMax }, \
+	{ false, "dot(_)", tyvmDot }, \
+	{ false, "axpy(_,_)", tyvmAxpy }, \
+	{ false, "scale(_)", tyvmScale }, \
+	{ false, "fill(_)", tyvmFill }, \
+	{ false, "clamp(_,_)", tyvmClamp }, \
+	{ false, "prefixSum()", tyvmPrefixSum }, \
+	{ false, "mask(_)", tyvmMask }, \
+	{ false, NULL, NULL }
+
+const vmForeignMethodDef _yf_func[] = { TYVM_METHODS(tyvmFromListF64) };
+const vmForeignMethodDef _yi_func[] = { TYVM_METHODS(tyvmFromListI32) };
+
+// class methods in this module
+const vmForeignMethodTable _y_mtab[] = {
+	{ "Float64Array", _yf_func },
+	{ "Int32Array", _yi_func },
+	{ NULL, NULL } };
+
+// foreign classes in this module
+const vmForeignClassDef _y_cdef[] = {
+	{ "Float64Array", { tyvmAllocateF64, tyvmFinalize } },
+	{ "Int32Array", { tyvmAllocateI32, tyvmFinalize } },
+	{ NULL, { NULL, NULL } } };
+const vmForeignClassTable _y_ctab[] = { { _y_cdef } };
+
+const vmForeignModule vmiTyped = { _y_mtab, _y_ctab };
@@ -0,0 +1,16 @@
+/*
+	cls_typed.h
+
+	wren running under lua 5.1+
+	implementation of Float64Array and Int32Array classes
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "vm.h"
+void tyvmRelease(vmTypedArray *arr);
+void tyvmLuaPush(lua_State *L, vmTypedArray *arr);
+void tyvmLuaToSlot(carricaVM *cvm, int slot, int idx);
+extern luaL_Reg tyvmLuaMeta[];
+extern const vmForeignModule vmiTyped;
@@ -0,0 +1,503 @@
+/*
+	cls_vector.c
+
+	wren running under lua 5.1+
+	implementation of Vector class
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "cls_vector.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WERR(x) { wrenError(vm, x); return; }
+
+static const char *vvmNotHeld = "a Vector only holds null, booleans, numbers and strings";
+static const char *vvmNoMemory = "out of memory for a Vector";
+
+// ********************************************************************************
+// storage
+
+// NULL when there isn't the memory for it
+static vmVector* vvmNew() {
+	vmVector *vec = calloc(1, sizeof(vmVector));
+	if (vec) vec->refCount = 1;
+	return vec;
+}
+
+static void vvmFreeValue(vmValue *v) {
+	if (v->type == LUA_TSTRING) free(v->as.s);
+	v->type = LUA_TNIL;
+}
+
+// drop a reference, the storage goes when Wren and every lua proxy let go
+void vvmRelease(vmVector *vec) {
+	if (--vec->refCount > 0) return;
+	for (int i = 0; i < vec->count; i++) vvmFreeValue(&vec->data[i]);
+	free(vec->data);
+	free(vec);
+}
+
+// make room for count elements, new elements are nil, false (and the
+// elements left as they were) when there isn't the memory
+static bool vvmReserve(vmVector *vec, int count) {
+	if (count <= vec->capacity) return true;
+	int cap = (vec->capacity > INT_MAX / 2) ? INT_MAX : vec->capacity * 2;
+	if (cap < 8) cap = 8;
+	if (cap < count) cap = count;
+	if ((size_t)cap > SIZE_MAX / sizeof(vmValue)) return false;
+	vmValue *data = realloc(vec->data, sizeof(vmValue) * cap);
+	if (data == NULL) return false;
+	vec->data = data;
+	memset(&vec->data[vec->capacity], 0, sizeof(vmValue) * (cap - vec->capacity));
+	vec->capacity = cap;
+	return true;
+}
+
+// false, with v left as it was, when there isn't the memory
+static bool vvmSetString(vmValue *v, const char *s, int len) {
+	char *c = malloc(len + 1);
+	if (c == NULL) return false;
+	memcpy(c, s, len);
+	c[len] = 0;
+	vvmFreeValue(v);
+	v->type = LUA_TSTRING;
+	v->len = len;
+	v->as.s = c;
+	return true;
+}
+
+// ********************************************************************************
+// moving values to and from Wren
+
+// only plain values live in a Vector, NULL when it's stored and the error otherwise
+static const char *vvmFromSlot(WrenVM *vm, int slot, vmValue *v) {
+	const char *s;
+	int len;
+	switch (wrenGetSlotType(vm, slot)) {
+		case WREN_TYPE_NULL:
+			vvmFreeValue(v);
+			return NULL;
+		case WREN_TYPE_BOOL:
+			vvmFreeValue(v);
+			v->type = LUA_TBOOLEAN;
+			v->as.b = wrenGetSlotBool(vm, slot);
+			return NULL;
+		case WREN_TYPE_NUM:
+			vvmFreeValue(v);
+			v->type = LUA_TNUMBER;
+			v->as.n = wrenGetSlotDouble(vm, slot);
+			return NULL;
+		case WREN_TYPE_STRING:
+			s = wrenGetSlotBytes(vm, slot, &len);
+			return vvmSetString(v, s, len) ? NULL : vvmNoMemory;
+		default:
+			return vvmNotHeld;
+	}
+}
+
+// compare with the Wren value in slot without copying it
+static bool vvmEqualSlot(WrenVM *vm, int slot, vmValue *v) {
+	const char *s;
+	int len;
+	switch (wrenGetSlotType(vm, slot)) {
+		case WREN_TYPE_NULL: return v->type == LUA_TNIL;
+		case WREN_TYPE_BOOL: return (v->type == LUA_TBOOLEAN) && (v->as.b == wrenGetSlotBool(vm, slot));
+		case WREN_TYPE_NUM: return (v->type == LUA_TNUMBER) && (v->as.n == wrenGetSlotDouble(vm, slot));
+		case WREN_TYPE_STRING:
+			if (v->type != LUA_TSTRING) return false;
+			s = wrenGetSlotBytes(vm, slot, &len);
+			return (v->len == len) && !memcmp(v->as.s, s, len);
+		default: return false;
+	}
+}
+
+static void vvmToSlot(WrenVM *vm, int slot, vmValue *v) {
+	switch (v->type) {
+		case LUA_TBOOLEAN: wrenSetSlotBool(vm, slot, v->as.b); break;
+		case LUA_TNUMBER: wrenSetSlotDouble(vm, slot, v->as.n); break;
+		case LUA_TSTRING: wrenSetSlotBytes(vm, slot, v->as.s, v->len); break;
+		default: wrenSetSlotNull(vm, slot); break;
+	}
+}
+
+// turn a Wren index into a position, negative counts back from the end
+static int vvmIndex(WrenVM *vm, int slot, int count) {
+	if (wrenGetSlotType(vm, slot) != WREN_TYPE_NUM) return -1;
+	int i = (int)wrenGetSlotDouble(vm, slot);
+	if (i < 0) i += count;
+	return ((i < 0) || (i >= count)) ? -1 : i;
+}
+
+// make a new Vector foreign in slot 0, the class handle goes in classSlot, NULL
+// (and slot 0 untouched) when there isn't the memory
+static vmVector* vvmNewInSlot(WrenVM *vm, int classSlot) {
+	vmVector *vec = vvmNew();
+	if (vec == NULL) return NULL;
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (cvm->handle.Vector == NULL) cvm->handle.Vector = lcvmGetClassHandle(cvm, "carrica", "Vector");
+	wrenSetSlotHandle(vm, classSlot, cvm->handle.Vector);
+	vmWrenVector *w = wrenSetSlotNewForeign(vm, 0, classSlot, VM_WVECTOR_SIZE);
+	w->type = VM_WREN_SHARE_VECTOR;
+	w->cvm = cvm;
+	w->vec = vec;
+	return vec;
+}
+
+// ********************************************************************************
+// functions
+
+void vvmGet(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	int i = vvmIndex(vm, 1, vec->count);
+	if (i < 0) WERR("index out of bounds on Vector[]")
+	vvmToSlot(vm, 0, &vec->data[i]);
+}
+
+void vvmSet(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	int i = vvmIndex(vm, 1, vec->count);
+	if (i < 0) WERR("index out of bounds on Vector[]=")
+	const char *err = vvmFromSlot(vm, 2, &vec->data[i]);
+	if (err) WERR(err)
+}
+
+void vvmFilled(WrenVM *vm) {
+	double size = (wrenGetSlotType(vm, 1) == WREN_TYPE_NUM) ? wrenGetSlotDouble(vm, 1) : -1;
+	if (!(size >= 0)) WERR("bad size passed to Vector.filled()")
+	if (size > INT_MAX) WERR("Vector size is too big")
+	int cnt = (int)size;
+	wrenEnsureSlots(vm, 4);
+	vmValue v = { LUA_TNIL };
+	const char *err = vvmFromSlot(vm, 2, &v);
+	if (err) WERR(err)
+	vmVector *vec = vvmNewInSlot(vm, 3);
+	if ((vec == NULL) || !vvmReserve(vec, cnt)) {
+		vvmFreeValue(&v);
+		WERR(vvmNoMemory)
+	}
+	for (int i = 0; i < cnt; i++) {
+		if (v.type != LUA_TSTRING)
+			vec->data[i] = v;
+		else if (!vvmSetString(&vec->data[i], v.as.s, v.len)) {
+			vvmFreeValue(&v);
+			WERR(vvmNoMemory)
+		}
+		vec->count++;
+	}
+	vvmFreeValue(&v);
+}
+
+// append the elements of a Wren list, a chunk of slots at a time, NULL when
+// they all went in and the error otherwise
+static const char *vvmAddList(WrenVM *vm, vmVector *vec, int list) {
+	int cnt = wrenGetListCount(vm, list);
+	if ((cnt > INT_MAX - vec->count) || !vvmReserve(vec, vec->count + cnt)) return vvmNoMemory;
+	wrenEnsureSlots(vm, list + VM_LIST_CHUNK + 1);
+	for (int i = 0; i < cnt; i += VM_LIST_CHUNK) {
+		int n = (cnt - i < VM_LIST_CHUNK) ? cnt - i : VM_LIST_CHUNK;
+		wrenGetListElements(vm, list, i, n, list + 1);
+		for (int j = 0; j < n; j++) {
+			const char *err = vvmFromSlot(vm, list + 1 + j, &vec->data[vec->count]);
+			if (err) return err;
+			vec->count++;
+		}
+	}
+	return NULL;
+}
+
+void vvmFromList(WrenVM *vm) {
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST) WERR("bad value passed to Vector.fromList() list only")
+	wrenEnsureSlots(vm, 3);
+	vmVector *vec = vvmNewInSlot(vm, 2);
+	if (vec == NULL) WERR(vvmNoMemory)
+	const char *err = vvmAddList(vm, vec, 1);
+	if (err) WERR(err)
+}
+
+void vvmAdd(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	if ((vec->count == INT_MAX) || !vvmReserve(vec, vec->count + 1)) WERR(vvmNoMemory)
+	const char *err = vvmFromSlot(vm, 1, &vec->data[vec->count]);
+	if (err) WERR(err)
+	vec->count++;
+}
+
+void vvmAddAll(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	if (wrenGetSlotType(vm, 1) == WREN_TYPE_LIST) {
+		const char *err = vvmAddList(vm, vec, 1);
+		if (err) WERR(err)
+	} else if ((wrenGetSlotType(vm, 1) == WREN_TYPE_FOREIGN) &&
+			(((vmWrenVector*)wrenGetSlotForeign(vm, 1))->type == VM_WREN_SHARE_VECTOR)) {
+		vmVector *other = ((vmWrenVector*)wrenGetSlotForeign(vm, 1))->vec;
+		int cnt = other->count;
+		if ((cnt > INT_MAX - vec->count) || !vvmReserve(vec, vec->count + cnt)) WERR(vvmNoMemory)
+		for (int i = 0; i < cnt; i++) {
+			vec->data[vec->count] = other->data[i];
+			if (other->data[i].type == LUA_TSTRING) {
+				vec->data[vec->count].type = LUA_TNIL;
+				if (!vvmSetString(&vec->data[vec->count], other->data[i].as.s, other->data[i].len))
+					WERR(vvmNoMemory)
+			}
+			vec->count++;
+		}
+	} else
+		WERR("bad value passed to Vector.addAll() list or Vector only")
+}
+
+void vvmClear(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	for (int i = 0; i < vec->count; i++) vvmFreeValue(&vec->data[i]);
+	vec->count = 0;
+}
+
+void vvmCount(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	wrenSetSlotDouble(vm, 0, vec->count);
+}
+
+// find the Wren value in slot, -1 if not there (or not something we can hold)
+static int vvmFind(WrenVM *vm, vmVector *vec, int slot) {
+	for (int i = 0; i < vec->count; i++)
+		if (vvmEqualSlot(vm, slot, &vec->data[i])) return i;
+	return -1;
+}
+
+void vvmIndexOf(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	wrenSetSlotDouble(vm, 0, vvmFind(vm, vec, 1));
+}
+
+void vvmInsert(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_NUM) WERR("bad index passed to Vector.insert()")
+	int pos = (int)wrenGetSlotDouble(vm, 1);
+	// like List.insert(), a negative index counts back from one past the end
+	if (pos < 0) pos += vec->count + 1;
+	if ((pos < 0) || (pos > vec->count)) WERR("index out of bounds on Vector.insert()")
+	vmValue v = { LUA_TNIL };
+	const char *err = vvmFromSlot(vm, 2, &v);
+	if (err) WERR(err)
+	if ((vec->count == INT_MAX) || !vvmReserve(vec, vec->count + 1)) {
+		vvmFreeValue(&v);
+		WERR(vvmNoMemory)
+	}
+	memmove(&vec->data[pos + 1], &vec->data[pos], sizeof(vmValue) * (vec->count - pos));
+	vec->data[pos] = v;
+	vec->count++;
+	vvmToSlot(vm, 0, &vec->data[pos]);
+}
+
+// take element pos out, handing it back in slot 0
+static void vvmRemoveIndex(WrenVM *vm, vmVector *vec, int pos) {
+	vvmToSlot(vm, 0, &vec->data[pos]);
+	vvmFreeValue(&vec->data[pos]);
+	memmove(&vec->data[pos], &vec->data[pos + 1], sizeof(vmValue) * (vec->count - pos - 1));
+	vec->count--;
+	vec->data[vec->count].type = LUA_TNIL;
+}
+
+void vvmRemove(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	int pos = vvmFind(vm, vec, 1);
+	if (pos < 0)
+		wrenSetSlotNull(vm, 0);
+	else
+		vvmRemoveIndex(vm, vec, pos);
+}
+
+void vvmRemoveAt(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	int pos = vvmIndex(vm, 1, vec->count);
+	if (pos < 0) WERR("index out of bounds on Vector.removeAt()")
+	vvmRemoveIndex(vm, vec, pos);
+}
+
+void vvmSwap(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	int a = vvmIndex(vm, 1, vec->count);
+	int b = vvmIndex(vm, 2, vec->count);
+	if (a < 0) WERR("index a out of bounds on Vector.swap()")
+	if (b < 0) WERR("index b out of bounds on Vector.swap()")
+	vmValue t = vec->data[a];
+	vec->data[a] = vec->data[b];
+	vec->data[b] = t;
+}
+
+// copy n elements from start into the Wren list in slot list at index pos
+static void vvmToList(WrenVM *vm, vmVector *vec, int list, int pos, int start, int n) {
+	wrenEnsureSlots(vm, list + VM_LIST_CHUNK + 1);
+	for (int i = 0; i < n; i += VM_LIST_CHUNK) {
+		int c = (n - i < VM_LIST_CHUNK) ? n - i : VM_LIST_CHUNK;
+		for (int j = 0; j < c; j++) vvmToSlot(vm, list + 1 + j, &vec->data[start + i + j]);
+		wrenSetListElements(vm, list, pos + i, c, list + 1);
+	}
+}
+
+void vvmList(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	wrenSetSlotNewList(vm, 0);
+	wrenReserveList(vm, 0, vec->count);
+	vvmToList(vm, vec, 0, 0, 0, vec->count);
+}
+
+// fill a Wren list with up to it's count of elements from index start, the
+// same protocol Array uses so ArrayCursor walks us too
+void vvmChunk(WrenVM *vm) {
+	vmVector *vec = ((vmWrenVector*)wrenGetSlotForeign(vm, 0))->vec;
+	if (wrenGetSlotType(vm, 1) != WREN_TYPE_LIST || wrenGetSlotType(vm, 2) != WREN_TYPE_NUM)
+		WERR("bad parameters passed to Vector.chunk_(), list and number expected")
+	int start = (int)wrenGetSlotDouble(vm, 2);
+	int n = vec->count - start;
+	if (n > wrenGetListCount(vm, 1)) n = wrenGetListCount(vm, 1);
+	if (n < 0) n = 0;
+	vvmToList(vm, vec, 1, 0, start, n);
+	wrenSetSlotDouble(vm, 0, n);
+}
+
+void vvmAllocate(WrenVM* vm) {
+	vmVector *vec = vvmNew();
+	if (vec == NULL) WERR(vvmNoMemory)
+	vmWrenVector *w = wrenSetSlotNewForeign(vm, 0, 0, VM_WVECTOR_SIZE);
+	w->type = VM_WREN_SHARE_VECTOR;
+	w->cvm = wrenGetUserData(vm);
+	w->vec = vec;
+}
+
+void vvmFinalize(void *obj) {
+	vmWrenVector *w = obj;
+	vvmRelease(w->vec);
+}
+
+// ********************************************************************************
+// the lua side proxy, a userdata holding a reference to the storage
+
+void vvmLuaPush(lua_State *L, vmVector *vec) {
+	vmVector **p = lua_newuserdata(L, sizeof(vmVector*));
+	*p = vec;
+	vec->refCount++;
+	luaL_getmetatable(L, LUA_NAME_SVECTOR);
+	lua_setmetatable(L, -2);
+}
+
+// a proxy lua hands back becomes a new Wren Vector sharing the same storage
+void vvmLuaToSlot(carricaVM *cvm, int slot, int idx) {
+	vmVector *vec = *(vmVector**)lua_touserdata(cvm->L, idx);
+	if (cvm->handle.Vector == NULL) cvm->handle.Vector = lcvmGetClassHandle(cvm, "carrica", "Vector");
+	wrenSetSlotHandle(cvm->vm, slot, cvm->handle.Vector);
+	vmWrenVector *w = wrenSetSlotNewForeign(cvm->vm, slot, slot, VM_WVECTOR_SIZE);
+	w->type = VM_WREN_SHARE_VECTOR;
+	w->cvm = cvm;
+	w->vec = vec;
+	vec->refCount++;
+}
+
+static int vvmLuaIndex(lua_State *L) {
+	vmVector *vec = *(vmVector**)luaL_checkudata(L, 1, LUA_NAME_SVECTOR);
+	int i = lua_isnumber(L, 2) ? lua_tointeger(L, 2) : 0;
+	if ((i < 1) || (i > vec->count)) {
+		lua_pushnil(L);
+		return 1;
+	}
+	vmValue *v = &vec->data[i - 1];
+	switch (v->type) {
+		case LUA_TBOOLEAN: lua_pushboolean(L, v->as.b); break;
+		case LUA_TNUMBER: lua_pushnumber(L, v->as.n); break;
+		case LUA_TSTRING: lua_pushlstring(L, v->as.s, v->len); break;
+		default: lua_pushnil(L); break;
+	}
+	return 1;
+}
+
+// v[#v + 1] = x appends, like a lua table
+static int vvmLuaNewIndex(lua_State *L) {
+	vmVector *vec = *(vmVector**)luaL_checkudata(L, 1, LUA_NAME_SVECTOR);
+	int i = luaL_checkint(L, 2);
+	if ((i < 1) || (i > vec->count + 1)) luaL_error(L, "index out of bounds on Vector");
+	if (!vvmReserve(vec, i)) luaL_error(L, "%s", vvmNoMemory);
+	vmValue *v = &vec->data[i - 1];
+	size_t len;
+	const char *s;
+	switch (lua_type(L, 3)) {
+		case LUA_TNIL:
+			vvmFreeValue(v);
+			break;
+		case LUA_TBOOLEAN:
+			vvmFreeValue(v);
+			v->type = LUA_TBOOLEAN;
+			v->as.b = lua_toboolean(L, 3);
+			break;
+		case LUA_TNUMBER:
+			vvmFreeValue(v);
+			v->type = LUA_TNUMBER;
+			v->as.n = lua_tonumber(L, 3);
+			break;
+		case LUA_TSTRING:
+			s = lua_tolstring(L, 3, &len);
+			if ((len > INT_MAX) || !vvmSetString(v, s, (int)len)) luaL_error(L, "%s", vvmNoMemory);
+			break;
+		default:
+			luaL_error(L, "a Vector only holds nil, booleans, numbers and strings");
+	}
+	if (i > vec->count) vec->count = i;
+	return 0;
+}
+
+static int vvmLuaLen(lua_State *L) {
+	vmVector *vec = *(vmVector**)luaL_checkudata(L, 1, LUA_NAME_SVECTOR);
+	lua_pushinteger(L, vec->count);
+	return 1;
+}
+
+static int vvmLuaGC(lua_State *L) {
+	vvmRelease(*(vmVector**)luaL_checkudata(L, 1, LUA_NAME_SVECTOR));
+	return 0;
+}
+
+luaL_Reg vvmLuaMeta[] = {
+	{ "__index", vvmLuaIndex },
+	{ "__newindex", vvmLuaNewIndex },
+	{ "__len", vvmLuaLen },
+	{ "__gc", vvmLuaGC },
+	{ NULL, NULL }
+};
+
+// ********************************************************************************
+// wrap it all up for Wren
+
+const vmForeignMethodDef _v_func[] = {
+	{ false, "[_]", vvmGet },
+	{ false, "[_]=(_)", vvmSet },
+	{ true, "filled(_,_)", vvmFilled },
+	{ true, "fromList(_)", vvmFromList },
+	{ false, "add(_)", vvmAdd },
+	{ false, "addAll(_)", vvmAddAll },
+	{ false, "clear()", vvmClear },
+	{ false, "count", vvmCount },
+	{ false, "indexOf(_)", vvmIndexOf },
+	{ false, "insert(_,_)", vvmInsert },
+	{ false, "remove(_)", vvmRemove },
+	{ false, "removeAt(_)", vvmRemoveAt },
+	{ false, "swap(_,_)", vvmSwap },
+	{ false, "list", vvmList },
+	{ false, "chunk_(_,_)", vvmChunk },
+	{ false, NULL, NULL }
+};
+
+// class methods in this module
+const vmForeignMethodTable _v_mtab[] = {
+	{ "Vector", _v_func },
+	{ NULL, NULL } };
+
+// foreign classes in this module
+const vmForeignClassDef _v_cdef[] = {
+	{ "Vector", { vvmAllocate, vvmFinalize } },
+	{ NULL, { NULL, NULL } } };
+const vmForeignClassTable _v_ctab[] = { { _v_cdef } };
+
+const vmForeignModule vmiVector = { _v_mtab, _v_ctab };
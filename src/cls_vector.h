@@ -0,0 +1,16 @@
+/*
+	cls_vector.h
+
+	wren running under lua 5.1+
+	implementation of Vector class
+
+	muragami, muragami@wishray.com, Jason A. Petrasko 2024
+	MIT license: https://opensource.org/license/mit/
+*/
+
+#include "vm.h"
+void vvmRelease(vmVector *vec);
+void vvmLuaPush(lua_State *L, vmVector *vec);
+void vvmLuaToSlot(carricaVM *cvm, int slot, int idx);
+extern luaL_Reg vvmLuaMeta[];
+extern const vmForeignModule vmiVector;
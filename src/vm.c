@@ -14,9 +14,21 @@
 #include "cls_host.h"
 #include "cls_table.h"
 #include "cls_array.h"
+#include "cls_vector.h"
+#include "cls_typed.h"
+#include "cls_struct.h"
+#include "cls_bind.h"
+#include "cls_object.h"
 #include <memory.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+	#include <io.h>
+	#define write _write
+#else
+	#include <unistd.h>
+#endif
 
 // ********************************************************************************
 // internal type defs
@@ -34,7 +46,7 @@ typedef struct _vmModTable {
 	vmForeignModule* entry;
 } vmModTable;
 
-#define VM_CORE_MODULES		3
+#define VM_CORE_MODULES		5
 
 // ********************************************************************************
 // general static stuff for the VM system
@@ -44,6 +56,16 @@ carricaModTable shared;
 vmModTable imod;
 carricaModule selfMod;
 vmTable vmt;
+// constants defined for all VMs, in the core module so every module sees them
+typedef struct _vmSharedDefine {
+	char *name;
+	vmValue value;
+	unsigned int epoch;
+} vmSharedDefine;
+vmSharedDefine *sharedDefine = NULL;
+int sharedDefines = 0;
+// bumped on every carrica.defineShared(), each VM catches up to it itself
+unsigned int sharedDefineEpoch = 0;
 #ifdef CARRICA_USE_THREADS
 	pthread_mutex_t sharedLock;
 #endif
@@ -76,29 +98,27 @@ typedef struct _vmForkedPointer {
 } vmForkedPointer;
 
 const char *luaGetMetaTableType(lua_State *L, int idx) {
-	lua_getmetatable(L, idx);
-	luaL_getmetatable(L, LUA_NAME_SARRAY);
-	if (lua_equal(L, -1, -2))
-		return LUA_NAME_SARRAY;
-	else {
+	static const char *names[] = { LUA_NAME_SARRAY, LUA_NAME_S_UOBJ, LUA_NAME_STABLE,
+		LUA_NAME_SVECTOR, LUA_NAME_STYPED, LUA_NAME_SSTRUCT, NULL };
+	// leave the stack as we found it, idx may well be relative to the top
+	if (!lua_getmetatable(L, idx)) return NULL;
+	for (int i = 0; names[i] != NULL; i++) {
+		luaL_getmetatable(L, names[i]);
+		bool match = lua_rawequal(L, -1, -2);
 		lua_pop(L, 1);
-		luaL_getmetatable(L, LUA_NAME_S_UOBJ);
-		if (lua_equal(L, -1, -2))
-			return LUA_NAME_S_UOBJ;
-		else {
+		if (match) {
 			lua_pop(L, 1);
-			luaL_getmetatable(L, LUA_NAME_STABLE);
-			if (lua_equal(L, -1, -2))
-				return LUA_NAME_STABLE;
-			else
-				return NULL;
+			return names[i];
 		}
 	}
+	lua_pop(L, 1);
+	return NULL;
 }
 
 void wrenSetSlotFromLua(carricaVM *cvm, int slot, int idx) {
 	size_t len = 0;
 	vmForkedPointer p = { NULL };
+	vmWrenObject *o;
 	
 	switch (lua_type(cvm->L, idx)) {
 		case LUA_TNIL:
@@ -119,10 +139,23 @@ void wrenSetSlotFromLua(carricaVM *cvm, int slot, int idx) {
 			wrenError(cvm->vm, "VM -> you may not marshal tables from lua to Wren");
 			break;
 		case LUA_TUSERDATA:
+			// a Wren object lua was holding goes straight back
+			if ((o = ovmLuaTest(cvm->L, idx)) != NULL) {
+				if (o->cvm != cvm) wrenError(cvm->vm, "VM -> a Wren object can only go back to the VM it came from");
+				else wrenSetSlotHandle(cvm->vm, slot, o->handle);
+				break;
+			}
 			// see if this is a wren reference
 			p.str = luaGetMetaTableType(cvm->L, idx);
 			if (p.str == NULL) {
 				wrenError(cvm->vm, "VM -> unknown user data from lua!?");
+			} else if (!strcmp(p.str, LUA_NAME_SVECTOR)) {
+				// C owned storage goes back as a new Wren object sharing it
+				vvmLuaToSlot(cvm, slot, idx);
+			} else if (!strcmp(p.str, LUA_NAME_STYPED)) {
+				tyvmLuaToSlot(cvm, slot, idx);
+			} else if (!strcmp(p.str, LUA_NAME_SSTRUCT)) {
+				svmLuaToSlot(cvm, slot, idx);
 			} else {
 				// it is, so marshal that into wren
 				p.ref = lua_touserdata(cvm->L, idx);
@@ -157,17 +190,39 @@ void luaPushFromWrenSlot(carricaVM *cvm, int slot) {
   			ref = wrenGetSlotForeign(cvm->vm, slot);
   			switch (ref->type) {
   				case VM_WREN_SHARE_ARRAY:
+  					// a view goes over as a proxy onto the parent table
+  					if (ref->view) {
+  						avmLuaPushView(cvm, ref);
+  						break;
+  					}
+  					// a whole Array falls through
   				case VM_WREN_SHARE_TABLE:
   				case VM_WREN_SHARE_LSOBJ:
-  					// find the ref and push it
+  					// find the ref and push it, lua now holds the raw table
+  					vmRefOwn(ref->pref);
+  					ref->pref->exposed = true;
   					lua_pushlightuserdata(cvm->L, ref->pref);
   					lua_gettable(cvm->L, LUA_REGISTRYINDEX);
   					break;
+  				case VM_WREN_SHARE_VECTOR:
+  					// lua gets a proxy onto our own storage
+  					vvmLuaPush(cvm->L, ((vmWrenVector*)ref)->vec);
+  					break;
+  				case VM_WREN_SHARE_TYPED:
+  					tyvmLuaPush(cvm->L, ((vmWrenTyped*)ref)->arr);
+  					break;
+  				case VM_WREN_SHARE_STRUCT:
+  					svmLuaPush(cvm->L, ((vmWrenStruct*)ref)->block, ((vmWrenStruct*)ref)->index);
+  					break;
   				default:
   					luaL_error(cvm->L, "VM -> unsupported foreign class passed to luaPushFromWrenSlot()");
   					break;
   			}
 			break;
+  		case WREN_TYPE_UNKNOWN:
+  			// any other object, lua gets a proxy holding a handle to it
+  			ovmLuaPush(cvm, slot);
+  			break;
   		case WREN_TYPE_LIST:
   		case WREN_TYPE_MAP:
   		default:
@@ -191,10 +246,15 @@ bool wrenSlotIsLuaSafe(carricaVM* cvm, int slot) {
   				case VM_WREN_SHARE_ARRAY:
   				case VM_WREN_SHARE_TABLE:
   				case VM_WREN_SHARE_LSOBJ:
+  				case VM_WREN_SHARE_VECTOR:
+  				case VM_WREN_SHARE_TYPED:
+  				case VM_WREN_SHARE_STRUCT:
   					return true;
   				default:
   					return false;
   			}
+  		case WREN_TYPE_UNKNOWN:
+  			return true;
   		case WREN_TYPE_LIST:
   		case WREN_TYPE_MAP:
   		default:
@@ -202,6 +262,176 @@ bool wrenSlotIsLuaSafe(carricaVM* cvm, int slot) {
 	}
 }
 
+// the values wrenSetSlotFromLua() takes without an error, for when there is
+// no fiber to abort
+bool luaIndexIsWrenSafe(carricaVM *cvm, int idx) {
+	vmWrenObject *o;
+	const char *p;
+	switch (lua_type(cvm->L, idx)) {
+		case LUA_TNIL:
+		case LUA_TBOOLEAN:
+		case LUA_TNUMBER:
+		case LUA_TSTRING:
+			return true;
+		case LUA_TUSERDATA:
+			if ((o = ovmLuaTest(cvm->L, idx)) != NULL) return o->cvm == cvm;
+			if ((p = luaGetMetaTableType(cvm->L, idx)) == NULL) return false;
+			return strcmp(p, LUA_NAME_SSTRUCT) || svmLuaIsImported(cvm, idx);
+		default:
+			return false;
+	}
+}
+
+// call into lua, after this anything lua holds may have been changed
+void vmLuaCall(carricaVM *cvm, int nargs, int nresults) {
+	lua_call(cvm->L, nargs, nresults);
+	cvm->luaEpoch++;
+}
+
+// ********************************************************************************
+// copy-on-write tables for Array and Table clones
+
+// point a new reference at the table of another, so a clone costs nothing
+// until one of them writes
+void vmRefShare(vmWrenReference *to, vmWrenReference *from) {
+	lua_State *L = from->cvm->L;
+	if (from->shared == NULL) {
+		from->shared = malloc(sizeof(int));
+		*from->shared = 1;
+	}
+	(*from->shared)++;
+	vmRefDrop(to);
+	to->shared = from->shared;
+	to->count = from->count;
+	to->epoch = from->epoch;
+	to->exposed = false;
+	lua_pushlightuserdata(L, to);
+	lua_pushlightuserdata(L, from);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	lua_settable(L, LUA_REGISTRYINDEX);
+}
+
+// call before writing to (or handing lua) the table of ref, if it is shared
+// we swap in a private copy first
+void vmRefOwn(vmWrenReference *ref) {
+	if (ref->shared == NULL) return;
+	if (*ref->shared == 1) {
+		// everyone else let go, so it is ours already
+		vmRefDrop(ref);
+		return;
+	}
+	lua_State *L = ref->cvm->L;
+	lua_pushlightuserdata(L, ref);
+	lua_pushlightuserdata(L, ref);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	int t = lua_gettop(L);
+	if (ref->type == VM_WREN_SHARE_ARRAY) {
+		int len = lua_objlen(L, t);
+		lua_createtable(L, len, 0);
+		for (int i = 1; i <= len; i++) {
+			lua_rawgeti(L, t, i);
+			lua_rawseti(L, t + 1, i);
+		}
+	} else {
+		lua_createtable(L, 0, ref->count);
+		lua_pushnil(L);
+		while (lua_next(L, t) != 0) {
+			lua_pushvalue(L, -2);
+			lua_insert(L, -2);
+			lua_rawset(L, t + 1);
+		}
+	}
+	lua_remove(L, t);
+	lua_settable(L, LUA_REGISTRYINDEX);
+	vmRefDrop(ref);
+}
+
+// let go of a shared table without copying it, when the reference is going
+// away or about to get a new table anyway
+void vmRefDrop(vmWrenReference *ref) {
+	if (ref->shared == NULL) return;
+	if (--(*ref->shared) == 0) free(ref->shared);
+	ref->shared = NULL;
+}
+
+// ********************************************************************************
+// the change journal lua can turn on for a Table or Array, every call is cheap
+// to make when it is off (ref->journal == NULL)
+
+static void vmJournalEmpty(vmJournal *j) {
+	for (int i = 0; i < j->count; i++)
+		if (j->entry[i].key.type == LUA_TSTRING) free(j->entry[i].key.as.s);
+	j->count = 0;
+}
+
+// the next free record, or NULL if we have to give up and flag a reset
+static vmJournalEntry* vmJournalNext(vmJournal *j) {
+	if (j->reset) return NULL;
+	if (j->count == j->capacity) {
+		vmJournalEmpty(j);
+		j->reset = true;
+		return NULL;
+	}
+	return &j->entry[j->count++];
+}
+
+// record op on the lua value at idx as the key, numbers and strings only
+void vmJournalKey(vmWrenReference *ref, int op, lua_State *L, int idx) {
+	vmJournal *j = ref->journal;
+	if (j == NULL) return;
+	int type = lua_type(L, idx);
+	if ((type != LUA_TNUMBER) && (type != LUA_TSTRING)) {
+		vmJournalReset(ref);
+		return;
+	}
+	vmJournalEntry *e = vmJournalNext(j);
+	if (e == NULL) return;
+	e->op = op;
+	e->key.type = type;
+	if (type == LUA_TNUMBER) {
+		e->key.as.n = lua_tonumber(L, idx);
+	} else {
+		size_t len;
+		const char *s = lua_tolstring(L, idx, &len);
+		e->key.len = (int)len;
+		e->key.as.s = malloc(len + 1);
+		if (e->key.as.s == NULL) {
+			// without the memory to keep the key, lua has to look at everything
+			j->count--;
+			vmJournalReset(ref);
+			return;
+		}
+		memcpy(e->key.as.s, s, len + 1);
+	}
+}
+
+void vmJournalIndex(vmWrenReference *ref, int op, int index) {
+	vmJournal *j = ref->journal;
+	if (j == NULL) return;
+	vmJournalEntry *e = vmJournalNext(j);
+	if (e == NULL) return;
+	e->op = op;
+	e->key.type = LUA_TNUMBER;
+	e->key.as.n = index;
+}
+
+// too much changed to list, lua has to look at the whole thing
+void vmJournalReset(vmWrenReference *ref) {
+	vmJournal *j = ref->journal;
+	if (j == NULL) return;
+	vmJournalEmpty(j);
+	j->reset = true;
+}
+
+void vmJournalFree(vmWrenReference *ref) {
+	vmJournal *j = ref->journal;
+	if (j == NULL) return;
+	vmJournalEmpty(j);
+	free(j->entry);
+	free(j);
+	ref->journal = NULL;
+}
+
 // ********************************************************************************
 // functions for the shared VM module table
 
@@ -350,6 +580,56 @@ void vmtRemove(carricaVM *cvm) {
 	vmtUnlock();
 }
 
+// push a shared constant to lua
+static void vmPushShared(lua_State *L, vmValue *v) {
+	switch (v->type) {
+		case LUA_TBOOLEAN: lua_pushboolean(L, v->as.b); break;
+		case LUA_TNUMBER: lua_pushnumber(L, v->as.n); break;
+		case LUA_TSTRING: lua_pushlstring(L, v->as.s, v->len); break;
+		default: lua_pushnil(L); break;
+	}
+}
+
+// define a shared constant in a VM
+static void vmSetShared(carricaVM *cvm, vmSharedDefine *d) {
+	vmPushShared(cvm->L, &d->value);
+	vmDefineVariable(cvm, NULL, d->name, lua_gettop(cvm->L));
+	lua_pop(cvm->L, 1);
+}
+
+// catch a VM up with the shared constants defined since it last looked, on
+// it's own thread: copies are taken holding the lock, then set without it
+static void vmApplyShared(carricaVM *cvm) {
+	vmsLock();
+	if (cvm->sharedEpoch == sharedDefineEpoch) {
+		vmsUnlock();
+		return;
+	}
+	vmSharedDefine *copy = malloc(sizeof(vmSharedDefine) * sharedDefines);
+	int count = 0;
+	for (int i = 0; copy && (i < sharedDefines); i++) {
+		vmSharedDefine *d = &sharedDefine[i];
+		if (d->epoch <= cvm->sharedEpoch) continue;
+		copy[count].name = strdup(d->name);
+		copy[count].value = d->value;
+		if (d->value.type == LUA_TSTRING) {
+			copy[count].value.as.s = malloc(d->value.len + 1);
+			if (copy[count].value.as.s) memcpy(copy[count].value.as.s, d->value.as.s, d->value.len + 1);
+		}
+		count++;
+	}
+	// out of memory leaves the epoch alone, so the next try picks them up
+	if (copy) cvm->sharedEpoch = sharedDefineEpoch;
+	vmsUnlock();
+	for (int i = 0; i < count; i++) {
+		bool string = (copy[i].value.type == LUA_TSTRING);
+		if (copy[i].name && (!string || copy[i].value.as.s)) vmSetShared(cvm, &copy[i]);
+		if (string) free(copy[i].value.as.s);
+		free(copy[i].name);
+	}
+	free(copy);
+}
+
 // install all shared modules into a VM
 void vmtInstallShared(carricaVM *cvm) {
 	vmsLock();
@@ -369,6 +649,7 @@ void vmtInstallShared(carricaVM *cvm) {
 		}
 	}
 	vmsUnlock();
+	vmApplyShared(cvm);
 }
 
 // add a new shared module to existing VMs
@@ -395,9 +676,8 @@ void vmtNewSharedModule(carricaModule *m) {
 // ********************************************************************************
 // internal mappings from Wren VM config
 
-void vmWriteFn(WrenVM* vm, const char* text) {
-	carricaVM *cvm = wrenGetUserData(vm);
-	if (!vmIsValid(cvm)) return;
+// hand text to the write handler
+static void vmWriteLua(carricaVM *cvm, const char *text, size_t len) {
 	lua_pushlightuserdata(cvm->L, cvm);
 	lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 	// we just pulled our table of handlers from the registry, grab the write
@@ -406,24 +686,60 @@ void vmWriteFn(WrenVM* vm, const char* text) {
 	if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
 		// a function, so call it
 		lua_pushvalue(cvm->L, -1);
-		lua_pushstring(cvm->L, text);
-		lua_call(cvm->L, 1, 0);
+		lua_pushlstring(cvm->L, text, len);
+		vmLuaCall(cvm, 1, 0);
 	} else if (lua_type(cvm->L, -1) == LUA_TTABLE) {
 		// a table so call .write() on it
 		lua_getfield(cvm->L, -1, "write");
 		if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
 			lua_pushvalue(cvm->L, -2);			// self (table)
-			lua_pushstring(cvm->L, text);		// the text
-			lua_call(cvm->L, 2, 0);
+			lua_pushlstring(cvm->L, text, len);	// the text
+			vmLuaCall(cvm, 2, 0);
 		}
 	}
 	lua_pop(cvm->L, 2);
 }
 
+// text goes to the file descriptor if we have one, lua if not
+static void vmWriteOut(carricaVM *cvm, const char *text, size_t len) {
+	if (cvm->out.fd < 0) {
+		vmWriteLua(cvm, text, len);
+		return;
+	}
+	while (len > 0) {
+		int n = write(cvm->out.fd, text, len);
+		if (n <= 0) return;
+		text += n;
+		len -= n;
+	}
+}
+
+void vmWriteFn(WrenVM* vm, const char* text) {
+	carricaVM *cvm = wrenGetUserData(vm);
+	if (!vmIsValid(cvm)) return;
+	vmOutput *o = &cvm->out;
+	size_t len = strlen(text);
+	if (o->mode == VM_OUTPUT_DIRECT) {
+		vmWriteOut(cvm, text, len);
+		return;
+	}
+	if (o->len + len > o->size) vmFlushOutput(cvm);
+	// too big to hold, so it goes right after what was held
+	if (len >= o->size) {
+		vmWriteOut(cvm, text, len);
+		return;
+	}
+	memcpy(o->data + o->len, text, len);
+	o->len += len;
+	if ((o->mode == VM_OUTPUT_LINE) && memchr(text, '\n', len)) vmFlushOutput(cvm);
+}
+
 void vmErrorFn(WrenVM* vm, WrenErrorType errorType, const char* module, 
 				const int line, const char* msg) {
 	carricaVM *cvm = wrenGetUserData(vm);
 	if (!vmIsValid(cvm)) return;
+	// what was printed before the error comes out first
+	vmFlushOutput(cvm);
 	switch (errorType) {
 			// A syntax or resolution error detected at compile time.
   			case WREN_ERROR_COMPILE:
@@ -447,14 +763,14 @@ void vmErrorFn(WrenVM* vm, WrenErrorType errorType, const char* module,
 		// a function, so call it
 		lua_pushvalue(cvm->L, -1);
 		lua_pushstring(cvm->L, cvm->buffer);
-		lua_call(cvm->L, 1, 0);
+		vmLuaCall(cvm, 1, 0);
 	} else if (lua_type(cvm->L, -1) == LUA_TTABLE) {
 		// a table so call .write() on it
 		lua_getfield(cvm->L, -1, "error");
 		if (lua_type(cvm->L, -1) == LUA_TFUNCTION) {
 			lua_pushvalue(cvm->L, -2);			// self (table)
 			lua_pushstring(cvm->L, cvm->buffer);		// the text
-			lua_call(cvm->L, 2, 0);
+			vmLuaCall(cvm, 2, 0);
 		}
 	}
 	lua_pop(cvm->L, 2);
@@ -528,6 +844,24 @@ WrenForeignClassMethods vmBindForeignClassFn(WrenVM* vm, const char* module,
 	return nullMethods;
 }
 
+// make the variables lua defined for module before it loaded, it's about to
+// be compiled (and so created) now
+static void vmApplyDefines(carricaVM *cvm, const char *module) {
+	int kept = 0;
+	for (int i = 0; i < cvm->defines; i++) {
+		vmDefine *d = &cvm->define[i];
+		if (strcmp(d->module, module)) {
+			cvm->define[kept++] = *d;
+			continue;
+		}
+		wrenSetModuleVariable(cvm->vm, module, d->name, d->value);
+		wrenReleaseHandle(cvm->vm, d->value);
+		free(d->module);
+		free(d->name);
+	}
+	cvm->defines = kept;
+}
+
 static void loadModuleComplete(WrenVM* vm, const char* module,
                                WrenLoadModuleResult result) {
   if (result.source) free((void*)result.source);
@@ -537,6 +871,7 @@ WrenLoadModuleResult vmLoadModule(WrenVM* vm, const char* name) {
 	WrenLoadModuleResult result = { NULL, NULL, NULL };
 	carricaVM *cvm = wrenGetUserData(vm);
 	carricaModTable *mod = &cvm->modtable;
+	vmApplyShared(cvm);
 #ifdef VM_DEBUG		
 	snprintf(ebuffer, 256, "\033[36m--   load: module = %s\033[0m", name);
 	EMIT("%s\n", ebuffer);
@@ -545,6 +880,7 @@ WrenLoadModuleResult vmLoadModule(WrenVM* vm, const char* name) {
 	for (int i = 0; i < mod->count; i++) {
 		if (mod->mod[i].def.name && !strcmp(name, mod->mod[i].def.name)) {
 			// found the module, return it
+			vmApplyDefines(cvm, name);
 			result.source = mod->mod[i].def.source;
 			return result;
 		}
@@ -554,7 +890,7 @@ WrenLoadModuleResult vmLoadModule(WrenVM* vm, const char* name) {
 		lua_pushlightuserdata(cvm->L, cvm->refs.loadModule);
 		lua_gettable(cvm->L, LUA_REGISTRYINDEX);
 		lua_pushstring(cvm->L, name);
-		lua_call(cvm->L, 1, 1);
+		vmLuaCall(cvm, 1, 1);
 		if (lua_type(cvm->L, -1) == LUA_TSTRING) {
 			const char *str;
 			char *mem;
@@ -566,6 +902,7 @@ WrenLoadModuleResult vmLoadModule(WrenVM* vm, const char* name) {
 			mem[len] = 0;
 			result.source = mem;
 			result.onComplete = loadModuleComplete;
+			vmApplyDefines(cvm, name);
 			lua_pop(cvm->L, 1);	// pop the string left on the stack
 			return result;
 		}
@@ -648,6 +985,8 @@ void vmBegin() {
 	memcpy(&imod.entry[0], &vmiHost, sizeof(vmForeignModule));
 	memcpy(&imod.entry[1], &vmiTable, sizeof(vmForeignModule));
 	memcpy(&imod.entry[2], &vmiArray, sizeof(vmForeignModule));
+	memcpy(&imod.entry[3], &vmiVector, sizeof(vmForeignModule));
+	memcpy(&imod.entry[4], &vmiTyped, sizeof(vmForeignModule));
 	// blank blank blank
 	memset(&shared, 0, VM_MOD_TAB_SIZE);
 	memset(&vmt, 0, sizeof(vmTable));
@@ -705,6 +1044,8 @@ void vmNew(lua_State *L, carricaVM *cvm, const char *name) {
 #ifdef VM_DEBUG
 		EMIT("\033[37mvm:: creating new VM '%s'\033[0m\n", cvm->name);
 #endif	
+	// output goes to the write handler as it comes, until lua says otherwise
+	cvm->out.fd = -1;
 	// configure the vm
 	conf->writeFn = vmWriteFn;
 	conf->errorFn = vmErrorFn;
@@ -744,6 +1085,9 @@ void vmRelease(carricaVM *cvm) {
 #ifdef VM_DEBUG
 		EMIT("\033[37mvm:: releasing VM '%s'\033[0m\n", cvm->name);
 #endif		
+		// anything still held is written before the handlers go
+		vmFlushOutput(cvm);
+		free(cvm->out.data);
 		// remove the VM from our internal table
 		vmtRemove(cvm);
 		// remove our lua registry table
@@ -761,6 +1105,19 @@ void vmRelease(carricaVM *cvm) {
   		}
   		// free the name string
   		free(cvm->name);
+		// let go of the lua functions bound to it
+		bvmRelease(cvm);
+		// and what Host kept for it
+		hvmRelease(cvm);
+		// and the Wren objects lua is holding
+		ovmRelease(cvm);
+		// and any variables still waiting for their module
+		for (int i = 0; i < cvm->defines; i++) {
+			wrenReleaseHandle(cvm->vm, cvm->define[i].value);
+			free(cvm->define[i].module);
+			free(cvm->define[i].name);
+		}
+		free(cvm->define);
 		// free the VM
 		wrenFreeVM(cvm->vm);
 #ifdef CARRICA_USE_THREADS
@@ -878,13 +1235,112 @@ void vmInstallSharedBinaryMod(carricaModule *_mod) {
 	vmtNewSharedModule(m);
 }
 
+// module NULL is the core module, so every module compiled afterwards has it, the
+// value also goes in the VM's const table for Host.const()
+bool vmDefineVariable(carricaVM *cvm, const char *module, const char *name, int idx) {
+	if (!vmIsValid(cvm)) return false;
+	lua_State *L = cvm->L;
+	if (!luaIndexIsWrenSafe(cvm, idx)) return false;
+	lua_pushlightuserdata(L, cvm->name);
+	lua_gettable(L, LUA_REGISTRYINDEX);
+	lua_pushvalue(L, idx);
+	lua_setfield(L, -2, name);
+	lua_pop(L, 1);
+	wrenEnsureSlots(cvm->vm, 1);
+	wrenSetSlotFromLua(cvm, 0, idx);
+	WrenHandle *value = wrenGetSlotHandle(cvm->vm, 0);
+	if ((module == NULL) || wrenHasModule(cvm->vm, module)) {
+		wrenSetModuleVariable(cvm->vm, module, name, value);
+		wrenReleaseHandle(cvm->vm, value);
+		return true;
+	}
+	// a later define of the same name wins
+	for (int i = 0; i < cvm->defines; i++) {
+		vmDefine *d = &cvm->define[i];
+		if (!strcmp(d->module, module) && !strcmp(d->name, name)) {
+			wrenReleaseHandle(cvm->vm, d->value);
+			d->value = value;
+			return true;
+		}
+	}
+	cvm->define = realloc(cvm->define, sizeof(vmDefine) * (cvm->defines + 1));
+	vmDefine *d = &cvm->define[cvm->defines++];
+	d->module = strdup(module);
+	d->name = strdup(name);
+	d->value = value;
+	return true;
+}
+
+bool vmDefineShared(lua_State *L, const char *name, int idx) {
+	int type = lua_type(L, idx);
+	if ((type != LUA_TNIL) && (type != LUA_TBOOLEAN) && (type != LUA_TNUMBER) && (type != LUA_TSTRING))
+		return false;
+	vmsLock();
+	vmSharedDefine *d = NULL;
+	for (int i = 0; i < sharedDefines; i++)
+		if (!strcmp(sharedDefine[i].name, name)) d = &sharedDefine[i];
+	if (d == NULL) {
+		sharedDefine = realloc(sharedDefine, sizeof(vmSharedDefine) * (sharedDefines + 1));
+		d = &sharedDefine[sharedDefines++];
+		d->name = strdup(name);
+	} else if (d->value.type == LUA_TSTRING)
+		free(d->value.as.s);
+	size_t len = 0;
+	const char *s;
+	d->value.type = type;
+	switch (type) {
+		case LUA_TBOOLEAN: d->value.as.b = lua_toboolean(L, idx); break;
+		case LUA_TNUMBER: d->value.as.n = lua_tonumber(L, idx); break;
+		case LUA_TSTRING:
+			s = lua_tolstring(L, idx, &len);
+			d->value.len = (int)len;
+			d->value.as.s = malloc(len + 1);
+			memcpy(d->value.as.s, s, len + 1);
+			break;
+		default: break;
+	}
+	// existing VMs pick it up themselves, next time they compile anything
+	d->epoch = ++sharedDefineEpoch;
+	vmsUnlock();
+	return true;
+}
+
+// false, with the output left as it was, when there isn't the memory for size
+bool vmSetOutput(carricaVM *cvm, int mode, int size, int fd) {
+	if (!vmIsValid(cvm)) return true;
+	vmFlushOutput(cvm);
+	vmOutput *o = &cvm->out;
+	if ((mode != VM_OUTPUT_DIRECT) && (size != o->size)) {
+		char *data = realloc(o->data, size);
+		if (data == NULL) return false;
+		o->data = data;
+		o->size = size;
+	}
+	o->mode = mode;
+	o->fd = fd;
+	return true;
+}
+
+void vmFlushOutput(carricaVM *cvm) {
+	int len = cvm->out.len;
+	if (len == 0) return;
+	// a write handler printing from Wren again starts a new buffer load
+	cvm->out.len = 0;
+	vmWriteOut(cvm, cvm->out.data, len);
+}
+
 void vmInterpret(carricaVM *cvm, const char *code, const char *module) {
 	if (vmIsValid(cvm)) {
 		if (module == NULL) module = "main";
+		// lua has been running since we were last in Wren
+		cvm->luaEpoch++;
 #ifdef VM_DEBUG
 		EMIT("\033[93mvm:: running interpret VM '%s' of module '%s'\033[0m\n", cvm->name, module);
 #endif		
+		vmApplyShared(cvm);
+		vmApplyDefines(cvm, module);
 		wrenInterpret(cvm->vm, module, code);
+		vmFlushOutput(cvm);
 	}
 }
 
@@ -924,6 +1380,8 @@ void vmFreeMethod(carricaVM* cvm, vmWrenMethod *p) {
 }
 
 void vmCallMethodFromLua(carricaVM *cvm, vmWrenMethod *p, int top) {
+	// lua has been running since we were last in Wren
+	cvm->luaEpoch++;
 	// make sure we have slots
 	wrenEnsureSlots(cvm->vm, top + 1);
 	// setup the receiver class
@@ -933,4 +1391,5 @@ void vmCallMethodFromLua(carricaVM *cvm, vmWrenMethod *p, int top) {
 		wrenSetSlotFromLua(cvm, i, i);
 	// make the call
 	wrenCall(cvm->vm, p->hMethod);
+	vmFlushOutput(cvm);
 }
\ No newline at end of file
@@ -62,13 +62,134 @@ typedef struct _carricaModTable {
 typedef struct _carricaTypeHandles {
 	WrenHandle* Table;
 	WrenHandle* Array;
-	WrenHandle* TableEntry;
+	WrenHandle* Vector;
+	WrenHandle* Float64Array;
+	WrenHandle* Int32Array;
 } carricaTypeHandles;
 
 typedef struct _carricaLuaRefs {
 	void *loadModule;
 } carricaLuaRefs;
 
+// a lua function Wren calls straight through one of the trampolines made for
+// vm:bindClass() and vm:defineLuaClass(), ref is it's place in the lua registry
+// and a method is handed the lua object of the instance as self
+typedef struct _vmBinding {
+	const char *module;
+	char *name;
+	int ref;
+	bool method;
+} vmBinding;
+
+// a generated module, for a lua class create is the registry ref of it's new
+// function (LUA_NOREF without one) and the instances are VM_WREN_SHARE_LSOBJ
+typedef struct _vmBindModule {
+	carricaModDef def;
+	bool luaClass;
+	int create;
+} vmBindModule;
+
+// everything bound for a VM, entry n belongs to trampoline n and the modules
+// hold the generated sources (they live as long as the VM does)
+typedef struct _vmBindings {
+	int count;
+	vmBinding *entry;
+	int modules;
+	vmBindModule *module;
+} vmBindings;
+
+// calls queued by Host.post() for lua to run with vm:drainCommands(), a command
+// is the handler (a VM_POST_REF and int reference, or a VM_POST_NAME and string),
+// a byte count of arguments and then each as a VM_POST_* tag and it's bytes;
+// read is how far lua got, objects how many foreign arguments are being held
+// in the registry (keyed by the buffer) until then
+typedef struct _vmCommandBuffer {
+	unsigned char *data;
+	int size;
+	int capacity;
+	int read;
+	int objects;
+} vmCommandBuffer;
+
+#define VM_POST_REF					0
+#define VM_POST_NAME				1
+#define VM_POST_NULL				2
+#define VM_POST_FALSE				3
+#define VM_POST_TRUE				4
+#define VM_POST_NUM					5
+#define VM_POST_STRING				6
+#define VM_POST_OBJECT				7
+
+// what Wren prints (System.print and friends), mode is one of VM_OUTPUT_* and
+// the text waits in data (size bytes) until a flush hands it to fd, when that
+// is 0 or more, or otherwise the write handler
+typedef struct _vmOutput {
+	int mode;
+	int fd;
+	int size;
+	int len;
+	char *data;
+} vmOutput;
+
+#define VM_OUTPUT_DIRECT			0		// every piece as Wren writes it
+#define VM_OUTPUT_LINE				1		// whole lines, or when data fills
+#define VM_OUTPUT_BUFFER			2		// when data fills or we go back to lua
+
+// a top level variable lua defined for a module that isn't loaded yet, it's
+// made just before the module compiles so the compiler sees it
+typedef struct _vmDefine {
+	char *module;
+	char *name;
+	WrenHandle *value;
+} vmDefine;
+
+// a Wren object lua holds through vm:getClassObj() or from a call, handle is
+// released when lua collects it or the VM goes (cvm is NULL after that), the
+// live ones are linked so the VM can let go of them first
+typedef struct _vmWrenObject {
+	struct _carricaVM *cvm;
+	WrenHandle *handle;
+	struct _vmWrenObject *prev;
+	struct _vmWrenObject *next;
+} vmWrenObject;
+
+// a top level Wren variable lua found once with vm:getVariableHandle(), obj holds
+// the module handle so it's freed like any other object, index is the variable
+typedef struct _vmWrenVariable {
+	vmWrenObject obj;
+	int index;
+} vmWrenVariable;
+
+#define VM_OBJECT_ARGS				16		// Wren's own limit on parameters
+
+// a method lua called on objects of a class, the call handles are made the
+// first time each arity is used, with getter set once we know if no arguments
+// means "method" rather than "method()"
+typedef struct _vmObjectMethod {
+	char *name;
+	int getter;
+	WrenHandle *call[VM_OBJECT_ARGS + 1];
+	WrenHandle *setter;
+	UT_hash_handle hh;
+} vmObjectMethod;
+
+// a class lua has seen objects of, found by it's identity and held by handle
+// so no other class can take it's place while we remember it
+typedef struct _vmObjectClass {
+	const void *id;
+	WrenHandle *handle;
+	vmObjectMethod *methods;
+	UT_hash_handle hh;
+} vmObjectClass;
+
+// the proxies and classes of a VM, the lua metatable of each class is kept
+// in the registry table under &objects, keyed by it's vmObjectClass, and the
+// proxies by their object in the one under &objects.classes
+typedef struct _vmObjects {
+	vmWrenObject *live;
+	vmObjectClass *classes;
+} vmObjects;
+
 typedef struct _carricaVM {
 	vmWrenMethod *methodHash;
 	WrenConfiguration config;
@@ -81,6 +202,15 @@ typedef struct _carricaVM {
 	int id;
 	char* name;
 	char* wrenName;
+	unsigned int luaEpoch;
+	unsigned int sharedEpoch;
+	vmBindings *bind;
+	vmCommandBuffer post;
+	WrenHandle* multi;
+	vmDefine *define;
+	int defines;
+	vmOutput out;
+	vmObjects objects;
 #ifdef CARRICA_USE_THREADS
 	pthread_mutex_t lock;
 #endif
@@ -126,26 +256,175 @@ typedef int (*vmDebugEmit)(const char *s, ...);
 #define VM_WREN_SHARE_ARRAY			0xF0F00001
 #define VM_WREN_SHARE_TABLE			0xF0F00002
 #define VM_WREN_SHARE_LSOBJ			0xF0F00003
-#define VM_WREN_SHARE_TABLE_ENTRY	0xF0F00004
+#define VM_WREN_SHARE_VECTOR		0xF0F00004
+#define VM_WREN_SHARE_TYPED			0xF0F00005
+#define VM_WREN_SHARE_STRUCT		0xF0F00006
 
 typedef struct _vmWrenReference {
 	int type;
 	int refCount;
 	WrenHandle* handle;
 	carricaVM *cvm;
+	// Table only: a maintained element count, exact unless lua was handed the
+	// raw table (exposed) and has run since the count was verified (epoch)
+	int count;
+	unsigned int epoch;
+	bool exposed;
+	// copy-on-write: when set, the table is shared with clones and this is how
+	// many references own it, the first write makes a private copy
+	int *shared;
+	// when lua turned it on, the writes made from Wren since lua last looked
+	struct _vmJournal *journal;
+	// Array only: a value -> first index table is kept in the registry (keyed
+	// by &indexed), good under the same rules as the Table count
+	bool indexed;
+	unsigned int indexEpoch;
+	// Table only: the lua keys of the walks Wren has under way are kept in the
+	// registry (keyed by &cursors), by the identity of each cursor list
+	bool cursors;
 } vmWrenReference;
 
 typedef struct _vmWrenReReference {
 	int type;
 	carricaVM *cvm;
 	vmWrenReference *pref;
+	// Array only: a view shares the table of pref, seeing length elements from offset
+	int offset;
+	int length;
+	bool view;
 } vmWrenReReference;
 
+// the lua side proxy for an Array view, the parent table is it's environment
+typedef struct _vmArrayView {
+	int offset;
+	int length;
+} vmArrayView;
+
+// a value held by a Vector, type is the matching LUA_T* constant and strings
+// are our own copy of len bytes (plus a terminator)
+typedef struct _vmValue {
+	int type;
+	int len;
+	union {
+		double n;
+		bool b;
+		char *s;
+	} as;
+} vmValue;
+
+// a record of Wren writing to a Table (or Array) for lua to catch up on, op is
+// one of VM_JOURNAL_* and key is the lua key (so 1 based for an Array)
+typedef struct _vmJournalEntry {
+	int op;
+	vmValue key;
+} vmJournalEntry;
+
+#define VM_JOURNAL_SET				1
+#define VM_JOURNAL_REMOVE			2
+#define VM_JOURNAL_INSERT			3
+
+// a bounded log of changes, once it fills up (or on a clear) we stop keeping
+// records and just tell lua to look at everything with reset
+typedef struct _vmJournal {
+	int count;
+	int capacity;
+	bool reset;
+	vmJournalEntry *entry;
+} vmJournal;
+
+// the C owned storage of a Vector, shared by it's Wren object and lua proxies
+typedef struct _vmVector {
+	int refCount;
+	int count;
+	int capacity;
+	vmValue *data;
+} vmVector;
+
+// a Vector as Wren holds it, type comes first to line up with vmWrenReReference
+typedef struct _vmWrenVector {
+	int type;
+	carricaVM *cvm;
+	vmVector *vec;
+} vmWrenVector;
+
+// the C storage of a typed array, elemType is VM_TYPED_F64 or VM_TYPED_I32
+typedef struct _vmTypedArray {
+	int refCount;
+	int elemType;
+	int count;
+	void *data;
+} vmTypedArray;
+
+#define VM_TYPED_F64				1
+#define VM_TYPED_I32				2
+
+// a typed array as Wren holds it, type comes first to line up with vmWrenReReference
+typedef struct _vmWrenTyped {
+	int type;
+	carricaVM *cvm;
+	vmTypedArray *arr;
+} vmWrenTyped;
+
+// one field of a struct defined from lua, type is one of VM_STRUCT_* and
+// offset is where it lives in a record
+typedef struct _vmStructField {
+	char *name;
+	int type;
+	int offset;
+} vmStructField;
+
+#define VM_STRUCT_I8				1
+#define VM_STRUCT_U8				2
+#define VM_STRUCT_I16				3
+#define VM_STRUCT_U16				4
+#define VM_STRUCT_I32				5
+#define VM_STRUCT_U32				6
+#define VM_STRUCT_F32				7
+#define VM_STRUCT_F64				8
+
+// the layout made by carrica.defineStruct(), these live as long as we do, id
+// is it's place in the list of definitions and size is the bytes per record
+typedef struct _vmStructDef {
+	int id;
+	int size;
+	int count;
+	char *name;
+	char *module;
+	char *source;
+	char *cdef;
+	char *ctype;
+	vmStructField *field;
+} vmStructDef;
+
+// count records of one struct in a single allocation, shared by the Wren
+// objects and lua proxies that look at them
+typedef struct _vmStructBlock {
+	int refCount;
+	int count;
+	vmStructDef *def;
+	unsigned char *data;
+} vmStructBlock;
+
+// a struct as Wren holds it, looking at record index of block, type comes first
+// to line up with vmWrenReReference
+typedef struct _vmWrenStruct {
+	int type;
+	carricaVM *cvm;
+	vmStructBlock *block;
+	int index;
+} vmWrenStruct;
+
 // ********************************************************************************
 // some internal cofiguration
 
 // allocate 16 entries for modules when initialized
 #define VM_MODULE_MINIMUM		16
+// move list elements to and from Wren this many slots at a time
+#define VM_LIST_CHUNK			64
+// bytes of output held by default when it's buffered
+#define VM_OUTPUT_SIZE			4096
+// records a change journal holds when lua doesn't ask for a size
+#define VM_JOURNAL_SIZE			256
 // size of the VM struct
 #define VM_BYTE_SIZE			sizeof(carricaVM)
 // size of the VM module struct
@@ -158,6 +437,14 @@ typedef struct _vmWrenReReference {
 #define VM_REF_SIZE				sizeof(vmWrenReference)
 // size of the VM module table struct
 #define VM_REREF_SIZE			sizeof(vmWrenReReference)
+// size of the Array view proxy struct
+#define VM_VIEW_SIZE			sizeof(vmArrayView)
+// size of the Wren side Vector struct
+#define VM_WVECTOR_SIZE			sizeof(vmWrenVector)
+// size of the Wren side typed array struct
+#define VM_WTYPED_SIZE			sizeof(vmWrenTyped)
+// size of the Wren side struct
+#define VM_WSTRUCT_SIZE			sizeof(vmWrenStruct)
 // size of the wrenMethod table struct
 #define VM_WMETHOD_SIZE			sizeof(vmWrenMethod)
 
@@ -169,6 +456,15 @@ void wrenError(WrenVM* vm, const char* err);
 void wrenSetSlotFromLua(carricaVM *cvm, int slot, int idx);
 void luaPushFromWrenSlot(carricaVM *cvm, int slot);
 bool wrenSlotIsLuaSafe(carricaVM *cvm, int slot);
+bool luaIndexIsWrenSafe(carricaVM *cvm, int idx);
+void vmLuaCall(carricaVM *cvm, int nargs, int nresults);
+void vmRefShare(vmWrenReference *to, vmWrenReference *from);
+void vmRefOwn(vmWrenReference *ref);
+void vmRefDrop(vmWrenReference *ref);
+void vmJournalKey(vmWrenReference *ref, int op, lua_State *L, int idx);
+void vmJournalIndex(vmWrenReference *ref, int op, int index);
+void vmJournalReset(vmWrenReference *ref);
+void vmJournalFree(vmWrenReference *ref);
 
 // ********************************************************************************
 // VM functions
@@ -202,6 +498,18 @@ void vmInstallBinaryMod(carricaVM* cvm, carricaModule* mod);
 void vmInstallSharedSourceDef(carricaModDef* def);
 void vmInstallSharedSource(const char* name, const char* source);
 void vmInstallSharedBinaryMod(carricaModule* mod);
+// make a lua value (at idx of the VM's lua state) a top level variable of a module,
+// false if it's not a value that can go to Wren
+bool vmDefineVariable(carricaVM* cvm, const char* module, const char* name, int idx);
+// hold the lock on what is shared between VMs (shared modules, defines and structs)
+void vmsLock();
+void vmsUnlock();
+// define a nil, boolean, number or string for every module of every VM compiled afterwards
+bool vmDefineShared(lua_State* L, const char* name, int idx);
+// choose how Wren's output reaches lua (or a file descriptor, when fd >= 0)
+bool vmSetOutput(carricaVM* cvm, int mode, int size, int fd);
+// send any output being held
+void vmFlushOutput(carricaVM* cvm);
 // make some code happen
 void vmInterpret(carricaVM* vm, const char* code, const char* module);
 // get a method call handle
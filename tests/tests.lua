@@ -9,10 +9,12 @@ function readFile(file)
     return content
 end
 
-function runTest(file)
+function runTest(file, handlers)
     print('\n~~~ TEST: ' .. file .. '\n\n')
     -- create a new vm
     local vm = carrica.newVM(file)
+    -- some tests need lua to play along
+    if handlers then handlers(vm) end
     -- get a file string to execute
     local code = readFile(file)
     -- execute it
@@ -36,9 +38,348 @@ print('\n---\n')
 runTest('table.wren')
 print('\n---\n')
 
+-- lua_next() always gets back the very same key, not one rebuilt from Wren
+do
+    local vm = carrica.newVM('walk')
+    vm:handler('walked', function()
+        local t = vm:newTable()
+        local raw = t:ref()
+        -- a Table or Array key reaches Wren as itself but comes back as the raw table
+        raw[vm:newTable()] = 'table'
+        raw[vm:newArray()] = 'array'
+        raw[true] = 'boolean'
+        raw.name = 'string'
+        raw[2] = 'number'
+        return t
+    end)
+    vm:interpret('import "carrica" for Host\n' ..
+        'var t = Host.call(Host.ref("walked"))\n' ..
+        'var n = 0\n' ..
+        'for (e in t) n = n + 1\n' ..
+        'var m = 0\n' ..
+        't.eachValue {|v| m = m + 1 }\n' ..
+        'for (e in t) break\n' ..
+        'var k = 0\n' ..
+        't.eachKey {|key| k = k + 1 }\n' ..
+        'System.print("walked %(n), %(m) and after a break %(k) of 5 entries")\n')
+    vm:release()
+    print('\n---\n')
+end
+
 runTest('array.wren')
 print('\n---\n')
 
+-- under another LC_COLLATE Array.sort() still orders strings like table.sort()
+do
+    local was = os.setlocale(nil, 'collate')
+    local locale = os.setlocale('C.UTF-8', 'collate') or os.setlocale('C.utf8', 'collate') or was
+    local vm = carrica.newVM('collate')
+    vm:handler('check', function(sorted)
+        local expect = {}
+        for i = 1, #sorted do expect[i] = sorted[i] end
+        table.sort(expect)
+        local same = true
+        for i = 1, #expect do same = same and (expect[i] == sorted[i]) end
+        print('sort under another collation matches table.sort ' .. tostring(same) .. ' for ' .. #sorted .. ' strings')
+    end)
+    vm:interpret('import "carrica" for Host, Array\n' ..
+        'var a = Array.fromList(["b", "a\\0b", "a", "B", "a\\0a", "e", "\\u00e9", "", "ab"])\n' ..
+        'a.sort()\n' ..
+        'Host.call(Host.ref("check"), a)\n')
+    vm:release()
+    os.setlocale(was, 'collate')
+    print('\n---\n')
+end
+
+-- lua hands back whatever Wren gave it, so proxies go both ways
+local function echoHandlers(vm)
+    vm:handler('echo', function(x) return x end)
+end
+
+runTest('vector.wren', echoHandlers)
+print('\n---\n')
+
+runTest('typed.wren', echoHandlers)
+print('\n---\n')
+
+-- lua makes a Table and Array for Wren to write to, then reads back what changed
+local function journalHandlers(vm)
+    local shared = {}
+    vm:handler('journaled', function(which)
+        if not shared.table then
+            shared.table = vm:newTable()
+            shared.array = vm:newArray()
+            shared.table:journal(true)
+            shared.array:journal(4)
+            local spare = vm:newTable()
+            print('a huge journal: ' .. select(2, pcall(spare.journal, spare, 1e12)))
+        end
+        return shared[which]
+    end)
+    vm:handler('changes', function(which)
+        local list, reset = shared[which]:changes()
+        local out = {}
+        for i = 1, #list, 2 do out[#out + 1] = tostring(list[i]) .. ':' .. list[i + 1] end
+        return table.concat(out, ' ') .. (reset and ' (reset)' or '')
+    end)
+end
+runTest('journal.wren', journalHandlers)
+print('\n---\n')
+
+-- lua defines a struct, then reads and writes the records Wren hands it
+local cdef, ctype = carrica.defineStruct('Particle', { x = 'f32', y = 'f32', id = 'u32', hp = 'i16' })
+print('defineStruct gave ' .. cdef .. ' as ' .. ctype)
+local function structHandlers(vm)
+    local ok, ffi = pcall(require, 'ffi')
+    vm:handler('move', function(s)
+        if ok then
+            local p = ffi.cast(s.ctype .. '*', s.base)
+            for i = 0, #s - 1 do
+                p[i].x = p[i].x + 1
+                p[i].y = p[i].y * 2
+            end
+        else
+            for i = 1, #s do
+                s[i].x = s[i].x + 1
+                s[i].y = s[i].y * 2
+            end
+        end
+        return #s
+    end)
+    vm:handler('poke', function(s)
+        s.id = s.id + 100
+        s.hp = -5
+    end)
+    echoHandlers(vm)
+end
+runTest('struct.wren', structHandlers)
+print('\n---\n')
+
+-- Host calls of any arity, from a List or Array, and with many results
+local function hostCallHandlers(vm)
+    vm:handler('sum', function(...)
+        local t = 0
+        for i = 1, select('#', ...) do t = t + select(i, ...) end
+        return t
+    end)
+    vm:handler('split', function(s)
+        local out = {}
+        for w in s:gmatch('[^,]+') do out[#out + 1] = w end
+        return unpack(out)
+    end)
+end
+runTest('hostcall.wren', hostCallHandlers)
+print('\n---\n')
+
+-- constants lua defines as top level Wren variables before the code compiles
+carrica.defineShared('MAX_PLAYERS', 8)
+local function defineHandlers(vm)
+    vm:define('main', 'Title', 'carrica')
+    vm:define('main', 'Gravity', 9.8)
+    vm:define('settings', 'Debug', true)
+    vm:setLoadFunction(function(name)
+        if name == 'settings' then return 'var Mode = Debug ? "debug" : "release"\n' end
+    end)
+    -- an existing VM gets it too, for anything it compiles from now on
+    carrica.defineShared('Late', 'after')
+end
+runTest('define.wren', defineHandlers)
+do
+    -- main has already run when these arrive, a module of it's own keeps it's own
+    local vm = carrica.newVM('define.wren')
+    vm:interpret('var DefineOwn = "mine"\nSystem.print("main ran first")')
+    carrica.defineShared('AFTER_MAIN', 42)
+    carrica.defineShared('DefineOwn', 'shared')
+    vm:interpret('System.print("defined after main ran %(AFTER_MAIN), kept %(DefineOwn)")')
+    carrica.defineShared('AFTER_MAIN', 43)
+    vm:interpret('System.print("and redefined %(AFTER_MAIN)")')
+    vm:release()
+end
+print('\n---\n')
+
+-- Wren's output held and handed to lua in fewer, bigger pieces (or straight to stdout)
+print('\n~~~ TEST: output.wren\n\n')
+for _, mode in ipairs({ 'direct', 'line', 'buffer' }) do
+    local vm = carrica.newVM('output.wren')
+    local writes, text = 0, {}
+    vm:handler('write', function(s)
+        writes = writes + 1
+        text[#text + 1] = s
+    end)
+    vm:setOutput(mode, 256)
+    vm:interpret(readFile('output.wren'))
+    local all = table.concat(text)
+    print(mode .. ': ' .. writes .. ' writes of ' .. #all .. ' bytes, ends "' .. all:sub(-14) .. '"')
+    vm:release()
+end
+do
+    local vm = carrica.newVM('output.wren')
+    vm:setOutput('line', 4096, 1)
+    vm:interpret('System.print("straight to stdout, lua never sees this")')
+    print('a huge buffer: ' .. select(2, pcall(vm.setOutput, vm, 'buffer', 1e12)))
+    vm:interpret('System.print("and the old buffer still works")')
+    vm:release()
+end
+print('\n~~~\n')
+print('\n---\n')
+
+-- lua functions bound as a Wren class, no handler lookup between them
+local function bindHandlers(vm)
+    vm:bindClass('api', 'Api', {
+        print = print,
+        add = function(a, b) return a + b end,
+        greet = function(name) return 'hello ' .. name end,
+        count = function(...) return select('#', ...) end,
+        nothing = function() end,
+    })
+end
+runTest('bind.wren', bindHandlers)
+print('\n---\n')
+
+-- a Wren class with a lua table behind each instance, lua counts the live ones
+local function luaClassHandlers(vm)
+    local live = setmetatable({}, { __mode = 'k' })
+    vm:bindClass('api', 'Api', {
+        print = print,
+        peek = function(actor) return actor.x end,
+        live = function()
+            collectgarbage()
+            local n = 0
+            for _ in pairs(live) do n = n + 1 end
+            return n
+        end,
+    })
+    vm:defineLuaClass('actors', 'Actor', {
+        new = function(self, name, speed)
+            self.name, self.speed, self.x, self.y, self.moves = name, speed or 1, 0, 0, 0
+            live[self] = true
+        end,
+        move = function(self, dx, dy)
+            self.x = self.x + dx * self.speed
+            self.y = self.y + dy * self.speed
+            self.moves = self.moves + 1
+        end,
+        steps = function(self) return self.moves end,
+        describe = function(self)
+            return self.name .. ' at ' .. self.x .. ', ' .. self.y
+        end,
+    })
+end
+runTest('luaclass.wren', luaClassHandlers)
+print('\n---\n')
+
+-- Wren posts calls which lua then makes all at once
+local function postHandlers(vm)
+    local drawn, sum = 0, 0
+    vm:handler('draw', function(x, y)
+        drawn = drawn + 1
+        sum = sum + x + y
+    end)
+    vm:handler('log', function(...)
+        local out = {}
+        for i = 1, select('#', ...) do out[i] = tostring((select(i, ...))) end
+        print('log: ' .. table.concat(out, ' '))
+    end)
+    vm:handler('nested', function()
+        -- posting while draining is picked up by the same drain
+        vm:getMethod('main', 'Frame', 'run()')()
+    end)
+    return function()
+        local handlers = setmetatable({ inspect = function(t) print('inspect: hp ' .. t.hp) end }, {
+            __index = function(_, name)
+                if name ~= 'burst' then return nil end
+                vm:getMethod('main', 'Frame', 'flood()')()
+                return function(s) print('burst: ' .. s) end
+            end })
+        local n = vm:drainCommands(handlers)
+        print('drained ' .. n .. ' calls, drew ' .. drawn .. ' summing ' .. sum)
+        print('drained ' .. vm:drainCommands() .. ' calls the second time')
+    end
+end
+print('\n~~~ TEST: post.wren\n\n')
+do
+    local vm = carrica.newVM('post.wren')
+    local drain = postHandlers(vm)
+    vm:interpret(readFile('post.wren'))
+    drain()
+    print('\n~~~\n')
+    vm:release()
+end
+print('\n---\n')
+
+-- Wren objects held by lua, each method handle is made once per class
+print('\n~~~ TEST: object.wren\n\n')
+do
+    local vm = carrica.newVM('object.wren')
+    local kept
+    vm:bindClass('api', 'Api', { print = print, keep = function(obj) kept = obj end })
+    -- a second Counter, where n is a method rather than a getter
+    vm:setLoadFunction(function(name)
+        if name == 'other' then return 'class Counter {\n construct new() {}\n n() { "other" }\n}\n' end
+    end)
+    vm:interpret(readFile('object.wren'))
+    print('kept from Wren has n ' .. kept:n())
+    local Counter = vm:getClassObj('main', 'Counter')
+    local c = Counter:new(5)
+    print('made ' .. tostring(c):match('^%a+') .. ', add(3) gives back ' .. tostring(c:add(3)):match('^%a+'))
+    print('getter n ' .. c:n())
+    c.n = 20
+    print('setter n ' .. c:n())
+    c:add(1, 2)
+    print('add(1, 2) n ' .. c:n())
+    local d = c:clone()
+    d:reset()
+    print('clone reset n ' .. d:n() .. ', original n ' .. c:n())
+    print('static make() n ' .. Counter:make():n())
+    print('one metatable per class ' .. tostring(getmetatable(c) == getmetatable(d)))
+    local other = vm:getClassObj('other', 'Counter'):new()
+    print('other module Counter n ' .. other:n() .. ', own metatable ' .. tostring(getmetatable(other) ~= getmetatable(c)))
+    local swarm = vm:getClassObj('main', 'Swarm'):new()
+    swarm:add(c)
+    swarm:add(d)
+    for i = 1, 1000 do swarm:update(1) end
+    print('swarm total after 1000 updates ' .. swarm:total())
+    print('same proxy back ' .. tostring(rawequal(c, c:add(0))))
+    local flock = vm:getClassObj('main', 'Flock'):new()
+    flock:join(c)
+    flock:join(d)
+    print('flock has c ' .. tostring(flock:has(c)) .. ', d at ' .. flock:place(d) .. ', swarm ' .. tostring(flock:has(swarm)))
+    vm:freeClassObj(d)
+    print('freed: ' .. select(2, pcall(d.n, d)))
+    vm:release()
+    print('released: ' .. select(2, pcall(c.n, c)))
+    print('\n~~~\n')
+end
+print('\n---\n')
+
+-- top level variables found once, then read and written by index
+print('\n~~~ TEST: variable.wren\n\n')
+do
+    local vm = carrica.newVM('variable.wren')
+    vm:interpret(readFile('variable.wren'))
+    local score = vm:getVariableHandle('main', 'Score')
+    local tick = vm:getMethod('main', 'Game', 'tick()')
+    local seen = 0
+    for i = 1, 1000 do
+        tick()
+        seen = seen + score:get()
+    end
+    print('Score ' .. score:get() .. ', summed every tick ' .. seen)
+    score:set(42)
+    vm:getVariableHandle('main', 'Name'):set('lua')
+    vm:getMethod('main', 'Game', 'report()')()
+    local out = {}
+    local values = vm:getVariables('main', { 'Score', 'Name', 'Items', 'Missing' }, out)
+    print('getVariables filled the table passed ' .. tostring(values == out))
+    print('Score ' .. values.Score .. ' Name ' .. values.Name .. ' Items ' .. tostring(values.Items) .. ' Missing ' .. tostring(values.Missing))
+    print('missing: ' .. select(2, pcall(vm.getVariableHandle, vm, 'main', 'Missing')))
+    print('table: ' .. select(2, pcall(score.set, score, {})))
+    vm:release()
+    print('released: ' .. select(2, pcall(score.get, score)))
+    print('\n~~~\n')
+end
+print('\n---\n')
+
 carrica.setDebugEmit(customEmit)
 runTest('simple.wren')
 print('\n---\n')